@@ -0,0 +1,75 @@
+#include <benchmark/benchmark.h>
+
+#include <format>
+
+#include "corpus.h"
+#include "tc_lexer.h"
+#include "tc_parser.h"
+
+namespace
+{
+    std::vector<tcalc::arithmetic_expression> parse_arithmetic_corpus(const long precision)
+    {
+        std::vector<tcalc::arithmetic_expression> expressions;
+        tcalc::parser parser{tcalc::lexer::borrowing({}, true), precision};
+        for (const auto& line : corpus())
+        {
+            parser.reset(line);
+            auto expr = parser.parse_expression();
+            if (parser.diagnostic_bag().empty() && std::holds_alternative<tcalc::arithmetic_expression>(expr))
+                expressions.push_back(std::get<tcalc::arithmetic_expression>(std::move(expr)));
+        }
+        return expressions;
+    }
+
+    void evaluate_arithmetic(benchmark::State& state)
+    {
+        const long precision = static_cast<long>(state.range(0));
+        const auto expressions = parse_arithmetic_corpus(precision);
+        const tcalc::evaluator evaluator = corpus_evaluator(precision);
+
+        for (auto _ : state)
+        {
+            for (const auto& expr : expressions)
+                benchmark::DoNotOptimize(evaluator.evaluate_arithmetic(expr));
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * expressions.size()));
+    }
+
+    // One call of a builtin with real arguments inside its domain, so that the timing is of the computation rather
+    // than of an early domain error.
+    void builtin_call(benchmark::State& state, const std::string& source)
+    {
+        const long precision = static_cast<long>(state.range(0));
+        tcalc::parser parser{tcalc::lexer::borrowing(source, true), precision};
+        const auto expr = std::get<tcalc::arithmetic_expression>(parser.parse_expression());
+        const tcalc::evaluator evaluator = corpus_evaluator(precision);
+
+        if (const auto result = evaluator.evaluate_arithmetic(expr); result.is_error())
+        {
+            state.SkipWithError(std::string{tcalc::eval_error_type_name(result.error().type)}.c_str());
+            return;
+        }
+
+        for (auto _ : state)
+            benchmark::DoNotOptimize(evaluator.evaluate_arithmetic(expr));
+    }
+
+    const bool builtins_registered = []
+    {
+        for (const auto& [name, arity] : tcalc::evaluator::builtin_signatures())
+        {
+            // acosh and acoth are real only above 1; 0.5 is inside the real domain of every other builtin
+            std::string source = std::format("{}({}", name, name == "acosh" || name == "acoth" ? "1.5" : "0.5");
+            for (tcalc::fn_arity_t i = 1; i < arity; i++)
+                source += ",3";
+            source += ')';
+
+            benchmark::RegisterBenchmark(std::format("builtin/{}/{}", name, arity).c_str(), builtin_call, source)
+                ->ArgName("bits")->ArgsProduct({bench_precisions});
+        }
+        return true;
+    }();
+}
+
+BENCHMARK(evaluate_arithmetic)->ArgName("bits")->ArgsProduct({bench_precisions});
@@ -0,0 +1,55 @@
+#include <benchmark/benchmark.h>
+
+#include "corpus.h"
+#include "tc_lexer.h"
+#include "tc_parser.h"
+#include "tc_string_reader.h"
+
+static void string_reader_forward(benchmark::State& state)
+{
+    const std::string& text = corpus_text();
+    for (auto _ : state)
+    {
+        auto reader = tcalc::string_reader::borrowing(text);
+        while (reader.forward() != tcalc::end_of_file)
+        {
+        }
+        benchmark::DoNotOptimize(reader.current());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * text.size()));
+}
+BENCHMARK(string_reader_forward);
+
+static void lexer_next(benchmark::State& state)
+{
+    auto lexer = tcalc::lexer::borrowing({}, true);
+    int64_t tokens = 0;
+    for (auto _ : state)
+    {
+        for (const auto& line : corpus())
+        {
+            lexer.reset(line);
+            while (lexer.next().kind() != tcalc::token_kind::end_of_file)
+                tokens++;
+        }
+    }
+    state.SetItemsProcessed(tokens);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * corpus_text().size()));
+}
+BENCHMARK(lexer_next);
+
+static void parser_parse_expression(benchmark::State& state)
+{
+    const long precision = static_cast<long>(state.range(0));
+    tcalc::parser parser{tcalc::lexer::borrowing({}, true), precision};
+    for (auto _ : state)
+    {
+        for (const auto& line : corpus())
+        {
+            parser.reset(line);
+            benchmark::DoNotOptimize(parser.parse_expression());
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * corpus().size()));
+}
+BENCHMARK(parser_parse_expression)->ArgName("bits")->Arg(64)->Arg(4096);
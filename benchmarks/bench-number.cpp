@@ -0,0 +1,119 @@
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <utility>
+
+#include "corpus.h"
+#include "tc_number.h"
+
+namespace
+{
+    // Operands with every significand bit in use, so the cost is that of a full-precision operation. The complex
+    // variants have a non-zero imaginary part and take the slower complex paths.
+    std::pair<tcalc::number, tcalc::number> operands(const long precision, const bool complex)
+    {
+        tcalc::number x = tcalc::number::pi(precision);
+        x.div(x, 5);
+        tcalc::number y = tcalc::number::e(precision);
+        y.div(y, 3);
+
+        if (complex)
+        {
+            tcalc::number i{precision};
+            i.set(0, 1);
+            tcalc::number shift{precision};
+            shift.mul(y, i);
+            x.add(x, shift);
+            shift.mul(x, i);
+            y.sub(y, shift);
+        }
+        return {std::move(x), std::move(y)};
+    }
+
+    template<void (tcalc::number::*Fn)(const tcalc::number&)>
+    void unary(benchmark::State& state)
+    {
+        const long precision = static_cast<long>(state.range(0));
+        const auto [x, y] = operands(precision, state.range(1) != 0);
+        tcalc::number out{precision};
+        for (auto _ : state)
+        {
+            (out.*Fn)(x);
+            benchmark::DoNotOptimize(out);
+        }
+    }
+
+    template<void (tcalc::number::*Fn)(const tcalc::number&, const tcalc::number&)>
+    void binary(benchmark::State& state)
+    {
+        const long precision = static_cast<long>(state.range(0));
+        const auto [x, y] = operands(precision, state.range(1) != 0);
+        tcalc::number out{precision};
+        for (auto _ : state)
+        {
+            (out.*Fn)(x, y);
+            benchmark::DoNotOptimize(out);
+        }
+    }
+
+    template<void (tcalc::number::*Fn)(const tcalc::number&, unsigned long)>
+    void degrees(benchmark::State& state)
+    {
+        const long precision = static_cast<long>(state.range(0));
+        const auto [x, y] = operands(precision, state.range(1) != 0);
+        tcalc::number out{precision};
+        for (auto _ : state)
+        {
+            (out.*Fn)(x, 360);
+            benchmark::DoNotOptimize(out);
+        }
+    }
+
+    void format_string(benchmark::State& state, const tcalc::number_format format)
+    {
+        const long precision = static_cast<long>(state.range(0));
+        const auto [x, y] = operands(precision, state.range(1) != 0);
+        for (auto _ : state)
+            benchmark::DoNotOptimize(x.string(0, format));
+    }
+}
+
+#define NUMBER_BENCHMARK(fn) \
+    BENCHMARK(fn)->ArgNames({"bits", "complex"})->ArgsProduct({bench_precisions, {0, 1}})
+
+NUMBER_BENCHMARK(binary<&tcalc::number::add>)->Name("number/add");
+NUMBER_BENCHMARK(binary<&tcalc::number::sub>)->Name("number/sub");
+NUMBER_BENCHMARK(binary<&tcalc::number::mul>)->Name("number/mul");
+NUMBER_BENCHMARK(binary<&tcalc::number::div>)->Name("number/div");
+NUMBER_BENCHMARK(binary<&tcalc::number::pow>)->Name("number/pow");
+NUMBER_BENCHMARK(binary<&tcalc::number::nth_root>)->Name("number/nth_root");
+NUMBER_BENCHMARK(unary<&tcalc::number::negate>)->Name("number/negate");
+NUMBER_BENCHMARK(unary<&tcalc::number::sqrt>)->Name("number/sqrt");
+NUMBER_BENCHMARK(unary<&tcalc::number::reciprocal>)->Name("number/reciprocal");
+NUMBER_BENCHMARK(unary<&tcalc::number::exp>)->Name("number/exp");
+NUMBER_BENCHMARK(unary<&tcalc::number::log>)->Name("number/log");
+NUMBER_BENCHMARK(unary<&tcalc::number::ln>)->Name("number/ln");
+NUMBER_BENCHMARK(unary<&tcalc::number::sin>)->Name("number/sin");
+NUMBER_BENCHMARK(unary<&tcalc::number::cos>)->Name("number/cos");
+NUMBER_BENCHMARK(unary<&tcalc::number::tan>)->Name("number/tan");
+NUMBER_BENCHMARK(unary<&tcalc::number::asin>)->Name("number/asin");
+NUMBER_BENCHMARK(unary<&tcalc::number::acos>)->Name("number/acos");
+NUMBER_BENCHMARK(unary<&tcalc::number::atan>)->Name("number/atan");
+NUMBER_BENCHMARK(unary<&tcalc::number::sinh>)->Name("number/sinh");
+NUMBER_BENCHMARK(unary<&tcalc::number::cosh>)->Name("number/cosh");
+NUMBER_BENCHMARK(unary<&tcalc::number::tanh>)->Name("number/tanh");
+NUMBER_BENCHMARK(unary<&tcalc::number::asinh>)->Name("number/asinh");
+NUMBER_BENCHMARK(unary<&tcalc::number::acosh>)->Name("number/acosh");
+NUMBER_BENCHMARK(unary<&tcalc::number::atanh>)->Name("number/atanh");
+NUMBER_BENCHMARK(unary<&tcalc::number::abs>)->Name("number/abs");
+NUMBER_BENCHMARK(unary<&tcalc::number::arg>)->Name("number/arg");
+NUMBER_BENCHMARK(unary<&tcalc::number::conj>)->Name("number/conj");
+NUMBER_BENCHMARK(degrees<&tcalc::number::sin>)->Name("number/sin_degrees");
+NUMBER_BENCHMARK(degrees<&tcalc::number::cos>)->Name("number/cos_degrees");
+NUMBER_BENCHMARK(degrees<&tcalc::number::tan>)->Name("number/tan_degrees");
+NUMBER_BENCHMARK(degrees<&tcalc::number::asin>)->Name("number/asin_degrees");
+NUMBER_BENCHMARK(degrees<&tcalc::number::atan>)->Name("number/atan_degrees");
+BENCHMARK_CAPTURE(format_string, normal, tcalc::number_format::normal)->Name("number/string/normal")
+    ->ArgNames({"bits", "complex"})->ArgsProduct({bench_precisions, {0, 1}});
+BENCHMARK_CAPTURE(format_string, scientific, tcalc::number_format::scientific)->Name("number/string/scientific")
+    ->ArgNames({"bits", "complex"})->ArgsProduct({bench_precisions, {0, 1}});
@@ -0,0 +1,57 @@
+#include "corpus.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+
+#include "tc_lexer.h"
+#include "tc_parser.h"
+
+const std::vector<std::string>& corpus()
+{
+    static const std::vector<std::string> lines = []
+    {
+        const char* path = std::getenv("TCALC_BENCH_CORPUS");
+        std::ifstream in{path != nullptr ? path : TCALC_BENCH_CORPUS};
+        if (!in)
+            throw std::runtime_error{"cannot open the benchmark corpus"};
+
+        std::vector<std::string> result;
+        for (std::string line; std::getline(in, line);)
+        {
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            if (!line.empty() && !line.starts_with('#'))
+                result.push_back(std::move(line));
+        }
+        return result;
+    }();
+    return lines;
+}
+
+const std::string& corpus_text()
+{
+    static const std::string text = []
+    {
+        std::string result;
+        for (const auto& line : corpus())
+        {
+            result += line;
+            result += '\n';
+        }
+        return result;
+    }();
+    return text;
+}
+
+tcalc::evaluator corpus_evaluator(const long precision)
+{
+    tcalc::evaluator evaluator{precision};
+    for (const auto* assignment : {"x=3", "y=4", "r=2.5", "n=12", "rate=0.05"})
+    {
+        tcalc::parser parser{tcalc::lexer::borrowing(assignment, true), precision};
+        auto result = evaluator.evaluate(parser.parse_expression());
+        evaluator.commit_result(result.value());
+    }
+    return evaluator;
+}
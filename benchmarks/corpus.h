@@ -0,0 +1,22 @@
+#ifndef TCALC_BENCH_CORPUS_H
+#define TCALC_BENCH_CORPUS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "tc_evaluator.h"
+
+// Non-comment lines of corpus.txt, or of the file named by the TCALC_BENCH_CORPUS environment variable.
+const std::vector<std::string>& corpus();
+
+// All corpus lines joined with newlines, for the benchmarks that scan text without parsing it.
+const std::string& corpus_text();
+
+// Precisions, in bits, that every numeric benchmark runs at.
+inline const std::vector<int64_t> bench_precisions = {64, 256, 1024, 4096};
+
+// An evaluator with the variables the corpus refers to.
+tcalc::evaluator corpus_evaluator(long precision);
+
+#endif // TCALC_BENCH_CORPUS_H
@@ -0,0 +1,59 @@
+#ifndef ALLOCATOR_H
+#define ALLOCATOR_H
+
+#include <atomic>
+
+namespace tcalc::allocator_detail
+{
+    // Set by the first number, after which the allocator can no longer be installed.
+    extern std::atomic<bool> numbers_created;
+
+    inline void note_number_created()
+    {
+        if (!numbers_created.load(std::memory_order_relaxed))
+            numbers_created.store(true, std::memory_order_relaxed);
+    }
+
+    struct thread_state;
+
+    // While alive, GMP memory allocated on this thread comes from the thread's bump arena, if the allocator is
+    // installed and no outer scope already owns the arena. Frees into the arena cost nothing; the arena is reset in
+    // O(1) when the owning scope ends, so nothing allocated in it may outlive the scope. MPFR's thread-local caches
+    // and integer pool, which may have grown into the arena, are freed along with it.
+    class arena_scope final
+    {
+    public:
+        arena_scope();
+        arena_scope(const arena_scope&) = delete;
+        arena_scope& operator=(const arena_scope&) = delete;
+        ~arena_scope();
+
+        [[nodiscard]]
+        bool owns_arena() const
+        {
+            return _state != nullptr;
+        }
+
+        // Stops serving allocations from the arena, so that values can be copied out of it before it is reset.
+        void release();
+
+    private:
+        thread_state* _state = nullptr;
+    };
+
+    // While alive, GMP memory allocated on this thread bypasses an arena that is serving it, for values that must
+    // outlive the enclosing arena_scope, such as caches kept by the evaluator.
+    class arena_pause final
+    {
+    public:
+        arena_pause();
+        arena_pause(const arena_pause&) = delete;
+        arena_pause& operator=(const arena_pause&) = delete;
+        ~arena_pause();
+
+    private:
+        thread_state* _state = nullptr;
+    };
+}
+
+#endif // ALLOCATOR_H
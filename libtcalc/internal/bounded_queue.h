@@ -0,0 +1,93 @@
+#ifndef TC_BOUNDED_QUEUE_H
+#define TC_BOUNDED_QUEUE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+namespace tcalc
+{
+    // A bounded multi-producer multi-consumer queue without locks. Each push and pop takes a ticket, and so a slot,
+    // with one atomic increment; a slot's sequence number then says whether it is ready to be written or read. A full
+    // queue makes producers wait on their slot and an empty one makes consumers wait, which is how the queue applies
+    // backpressure. Waiting uses C++20 atomic wait rather than spinning.
+    template<class T>
+    class bounded_queue final
+    {
+    public:
+        explicit bounded_queue(const size_t capacity) : _capacity{capacity}, _slots{std::make_unique<slot[]>(capacity)}
+        {
+            if (capacity == 0)
+                throw std::invalid_argument{"capacity"};
+            for (size_t i = 0; i < capacity; i++)
+                _slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        bounded_queue(const bounded_queue&) = delete;
+        bounded_queue& operator=(const bounded_queue&) = delete;
+
+        void push(T value)
+        {
+            const uint64_t ticket = _push_ticket.fetch_add(1, std::memory_order_relaxed);
+            slot& s = _slots[ticket % _capacity];
+            wait_for(s.sequence, ticket);
+
+            s.value.emplace(std::move(value));
+            s.sequence.store(ticket + 1, std::memory_order_release);
+            s.sequence.notify_all();
+        }
+
+        T pop()
+        {
+            const uint64_t ticket = _pop_ticket.fetch_add(1, std::memory_order_relaxed);
+            slot& s = _slots[ticket % _capacity];
+            wait_for(s.sequence, ticket + 1);
+
+            T value = std::move(*s.value);
+            s.value.reset();
+            s.sequence.store(ticket + _capacity, std::memory_order_release);
+            s.sequence.notify_all();
+            return value;
+        }
+
+        // Approximate number of items queued, counting pushes and pops still in progress.
+        [[nodiscard]]
+        size_t depth() const
+        {
+            const uint64_t pushed = _push_ticket.load(std::memory_order_relaxed);
+            const uint64_t popped = _pop_ticket.load(std::memory_order_relaxed);
+            return pushed > popped ? static_cast<size_t>(std::min<uint64_t>(pushed - popped, _capacity)) : 0;
+        }
+
+    private:
+        struct slot
+        {
+            std::atomic<uint64_t> sequence;
+            std::optional<T> value;
+        };
+
+        static void wait_for(const std::atomic<uint64_t>& sequence, const uint64_t expected)
+        {
+            while (true)
+            {
+                const uint64_t current = sequence.load(std::memory_order_acquire);
+                if (current == expected)
+                    return;
+                sequence.wait(current, std::memory_order_acquire);
+            }
+        }
+
+        size_t _capacity;
+        std::unique_ptr<slot[]> _slots;
+        alignas(64) std::atomic<uint64_t> _push_ticket{0};
+        alignas(64) std::atomic<uint64_t> _pop_ticket{0};
+    };
+}
+
+#endif // TC_BOUNDED_QUEUE_H
@@ -1,5 +1,8 @@
 #include "builtins.h"
 
+#include <stdexcept>
+#include <utility>
+
 using namespace tcalc;
 
 void tcalc::convert_angle(number& number, const angle_unit from, const angle_unit to)
@@ -32,20 +35,39 @@ void tcalc::convert_angle(number& number, const angle_unit from, const angle_uni
     }
 }
 
-eval_error_type tcalc::builtin_sqrt(evaluator::stack& stack, const evaluator&)
+unsigned long tcalc::units_per_turn(const angle_unit unit)
 {
+    switch (unit)
+    {
+        case angle_unit::degrees:
+            return 360;
+        case angle_unit::gradians:
+            return 400;
+        default:
+            throw std::invalid_argument{"unit"};
+    }
+}
+
+eval_error_type tcalc::builtin_sqrt(evaluator::stack& stack, const evaluator& eval)
+{
+    if (outside_real_domain<&real_domain_nonnegative>(stack.back(), eval))
+        return eval_error_type::real_mode_complex_result;
     stack.back().nth_root(stack.back(), 2);
     return eval_error_type::none;
 }
 
-eval_error_type tcalc::builtin_cbrt(evaluator::stack& stack, const evaluator&)
+eval_error_type tcalc::builtin_cbrt(evaluator::stack& stack, const evaluator& eval)
 {
+    if (outside_real_domain<&real_domain_nonnegative>(stack.back(), eval))
+        return eval_error_type::real_mode_complex_result;
     stack.back().nth_root(stack.back(), 3);
     return eval_error_type::none;
 }
 
-eval_error_type tcalc::builtin_fourth_root(evaluator::stack& stack, const evaluator&)
+eval_error_type tcalc::builtin_fourth_root(evaluator::stack& stack, const evaluator& eval)
 {
+    if (outside_real_domain<&real_domain_nonnegative>(stack.back(), eval))
+        return eval_error_type::real_mode_complex_result;
     stack.back().nth_root(stack.back(), 4);
     return eval_error_type::none;
 }
@@ -63,27 +85,33 @@ eval_error_type tcalc::builtin_root(evaluator::stack& stack, const evaluator& ev
 
     const auto n = std::move(stack.back());
     stack.pop_back();
+    if (outside_real_domain<&real_domain_nonnegative>(stack.back(), evaluator))
+        return eval_error_type::real_mode_complex_result;
     stack.back().nth_root(stack.back(), n);
     return eval_error_type::none;
 }
 
-eval_error_type tcalc::builtin_log1(evaluator::stack& stack, const evaluator&)
+eval_error_type tcalc::builtin_log1(evaluator::stack& stack, const evaluator& eval)
 {
     if (stack.back() == 0)
         return eval_error_type::log_zero;
+    if (outside_real_domain<&real_domain_nonnegative>(stack.back(), eval))
+        return eval_error_type::real_mode_complex_result;
     stack.back().log(stack.back());
     return eval_error_type::none;
 }
 
-eval_error_type tcalc::builtin_ln(evaluator::stack& stack, const evaluator&)
+eval_error_type tcalc::builtin_ln(evaluator::stack& stack, const evaluator& eval)
 {
     if (stack.back() == 0)
         return eval_error_type::log_zero;
+    if (outside_real_domain<&real_domain_nonnegative>(stack.back(), eval))
+        return eval_error_type::real_mode_complex_result;
     stack.back().ln(stack.back());
     return eval_error_type::none;
 }
 
-eval_error_type tcalc::builtin_log2(evaluator::stack& stack, const evaluator&)
+eval_error_type tcalc::builtin_log2(evaluator::stack& stack, const evaluator& eval)
 {
     if (stack.back() == 0 || stack.back() == 1)
         return eval_error_type::log_base;
@@ -91,63 +119,119 @@ eval_error_type tcalc::builtin_log2(evaluator::stack& stack, const evaluator&)
     stack.pop_back();
     if (stack.back() == 0)
         return eval_error_type::log_zero;
+    if (outside_real_domain<&real_domain_nonnegative>(base, eval)
+        || outside_real_domain<&real_domain_nonnegative>(stack.back(), eval))
+        return eval_error_type::real_mode_complex_result;
     base.ln(base);
     stack.back().ln(stack.back());
     stack.back().div(stack.back(), base);
     return eval_error_type::none;
 }
 
+// Extra precision for the sine, cosine and tangent that sec, csc and cot round once more, so that the final rounding in
+// degrees and gradians stays within an ulp of the correctly rounded result.
+static constexpr long turn_guard_bits = 32;
+
+static bool in_turn_units(const number& angle, const evaluator& eval)
+{
+    return angle.is_real() && eval.trig_unit() != angle_unit::radians;
+}
+
+// Applies Fn to the angle on top of the stack, or TurnFn with extra precision for real angles in degrees or gradians,
+// whose unit forms reduce the argument exactly. sec, csc and cot take the reciprocal after their domain checks.
+template<void (number::*Fn)(const number&), void (number::*TurnFn)(const number&, unsigned long)>
+static number trig_of_angle(const evaluator::stack& stack, const evaluator& eval)
+{
+    if (in_turn_units(stack.back(), eval))
+    {
+        number result{eval.precision() + turn_guard_bits};
+        (result.*TurnFn)(stack.back(), units_per_turn(eval.trig_unit()));
+        return result;
+    }
+    number result{eval.precision()};
+    (result.*Fn)(stack.back());
+    return result;
+}
+
+// The sine and cosine of an angle in radians or a complex angle, computed together.
+static std::pair<number, number> sin_cos(const number& angle, const evaluator& eval)
+{
+    std::pair<number, number> result{number{eval.precision()}, number{eval.precision()}};
+    result.first.sin_cos(result.second, angle);
+    return result;
+}
+
 eval_error_type tcalc::builtin_tan(evaluator::stack& stack, const evaluator& eval)
 {
-    if (stack.back().is_real())
-        convert_angle(stack.back(), eval.trig_unit(), angle_unit::radians);
-    number test{eval.precision()};
-    test.cos(stack.back());
-    if (test == 0)
+    if (in_turn_units(stack.back(), eval))
+    {
+        stack.back().tan(stack.back(), units_per_turn(eval.trig_unit()));
+        if (stack.back().is_infinity())
+            return eval_error_type::out_of_tan_domain;
+        if (stack.back() == 0) // Keep exact zeros unsigned
+            stack.back().set(0);
+        return eval_error_type::none;
+    }
+
+    const auto& [sin, cos] = sin_cos(stack.back(), eval);
+
+    if (cos == 0)
         return eval_error_type::out_of_tan_domain;
-    stack.back().tan(stack.back());
+
+    if (sin == 0) // Keep exact zeros unsigned
+        stack.back().set(0);
+    else
+        stack.back().div(sin, cos);
     return eval_error_type::none;
 }
 
 eval_error_type tcalc::builtin_sec(evaluator::stack& stack, const evaluator& eval)
 {
-    if (stack.back().is_real())
-      convert_angle(stack.back(), eval.trig_unit(), angle_unit::radians);
-
-    stack.back().cos(stack.back());
+    const number cos = trig_of_angle<&number::cos, &number::cos>(stack, eval);
 
-    if (stack.back() == 0)
-      return eval_error_type::out_of_sec_domain;
+    if (cos == 0)
+        return eval_error_type::out_of_sec_domain;
 
-    stack.back().reciprocal(stack.back());
+    stack.back().reciprocal(cos);
     return eval_error_type::none;
 }
 
 eval_error_type tcalc::builtin_csc(evaluator::stack& stack, const evaluator& eval)
 {
-    if (stack.back().is_real())
-        convert_angle(stack.back(), eval.trig_unit(), angle_unit::radians);
-
-    stack.back().sin(stack.back());
+    const number sin = trig_of_angle<&number::sin, &number::sin>(stack, eval);
 
-    if (stack.back() == 0)
+    if (sin == 0)
         return eval_error_type::out_of_csc_domain;
 
-    stack.back().reciprocal(stack.back());
+    stack.back().reciprocal(sin);
     return eval_error_type::none;
 }
 
 eval_error_type tcalc::builtin_cot(evaluator::stack& stack, const evaluator& eval)
 {
-    if (stack.back().is_real())
-        convert_angle(stack.back(), eval.trig_unit(), angle_unit::radians);
+    if (in_turn_units(stack.back(), eval))
+    {
+        const number tan = trig_of_angle<&number::tan, &number::tan>(stack, eval);
 
-    stack.back().tan(stack.back());
-    stack.back().reciprocal(stack.back());
+        if (tan == 0)
+            return eval_error_type::out_of_cot_domain;
 
-    if (stack.back().is_infinity())
+        if (tan.is_infinity())
+            stack.back().set(0);
+        else
+            stack.back().reciprocal(tan);
+        return eval_error_type::none;
+    }
+
+    const auto& [sin, cos] = sin_cos(stack.back(), eval);
+
+    if (sin == 0)
         return eval_error_type::out_of_cot_domain;
 
+    if (cos == 0)
+        stack.back().set(0);
+    else
+        stack.back().div(cos, sin);
     return eval_error_type::none;
 }
 
@@ -155,12 +239,11 @@ eval_error_type tcalc::builtin_asec(evaluator::stack& stack, const evaluator& ev
 {
     if (stack.back() == 0)
         return eval_error_type::out_of_asec_domain;
+    if (outside_real_domain<&real_domain_outside_unit_interval>(stack.back(), eval))
+        return eval_error_type::real_mode_complex_result;
 
     stack.back().reciprocal(stack.back());
-    stack.back().acos(stack.back());
-
-    if (stack.back().is_real())
-        convert_angle(stack.back(), angle_unit::radians, eval.trig_unit());
+    angle_result<&number::acos, &number::acos, &real_domain_unit_interval>(stack.back(), eval);
     return eval_error_type::none;
 }
 
@@ -168,22 +251,27 @@ eval_error_type tcalc::builtin_acsc(evaluator::stack& stack, const evaluator& ev
 {
     if (stack.back() == 0)
         return eval_error_type::out_of_acsc_domain;
+    if (outside_real_domain<&real_domain_outside_unit_interval>(stack.back(), eval))
+        return eval_error_type::real_mode_complex_result;
 
     stack.back().reciprocal(stack.back());
-    stack.back().asin(stack.back());
-
-    if (stack.back().is_real())
-        convert_angle(stack.back(), angle_unit::radians, eval.trig_unit());
+    angle_result<&number::asin, &number::asin, &real_domain_unit_interval>(stack.back(), eval);
     return eval_error_type::none;
 }
 
 eval_error_type tcalc::builtin_acot(evaluator::stack& stack, const evaluator& eval)
 {
     stack.back().reciprocal(stack.back());
-    stack.back().atan(stack.back());
+    angle_result<&number::atan, &number::atan, &real_domain_any>(stack.back(), eval);
+    return eval_error_type::none;
+}
 
-    if (stack.back().is_real())
-        convert_angle(stack.back(), angle_unit::radians, eval.trig_unit());
+eval_error_type tcalc::builtin_arg(evaluator::stack& stack, const evaluator& eval)
+{
+    if (eval.trig_unit() == angle_unit::radians)
+        stack.back().arg(stack.back());
+    else
+        stack.back().arg(stack.back(), units_per_turn(eval.trig_unit()));
     return eval_error_type::none;
 }
 
@@ -216,10 +304,12 @@ eval_error_type tcalc::builtin_coth(evaluator::stack& stack, const evaluator&)
     return eval_error_type::none;
 }
 
-eval_error_type tcalc::builtin_asech(evaluator::stack& stack, const evaluator&)
+eval_error_type tcalc::builtin_asech(evaluator::stack& stack, const evaluator& eval)
 {
     if (stack.back() == 0)
         return eval_error_type::out_of_asech_domain;
+    if (!eval.complex_mode() && (stack.back().is_negative() || stack.back() > 1))
+        return eval_error_type::real_mode_complex_result;
 
     stack.back().reciprocal(stack.back());
     stack.back().acosh(stack.back());
@@ -239,10 +329,12 @@ eval_error_type tcalc::builtin_acsch(evaluator::stack& stack, const evaluator&)
     return eval_error_type::none;
 }
 
-eval_error_type tcalc::builtin_acoth(evaluator::stack& stack, const evaluator&)
+eval_error_type tcalc::builtin_acoth(evaluator::stack& stack, const evaluator& eval)
 {
     if (stack.back() == 0)
         return eval_error_type::out_of_acoth_domain;
+    if (outside_real_domain<&real_domain_outside_unit_interval>(stack.back(), eval))
+        return eval_error_type::real_mode_complex_result;
 
     stack.back().reciprocal(stack.back());
     stack.back().atanh(stack.back());
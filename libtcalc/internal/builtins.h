@@ -7,30 +7,89 @@ namespace tcalc
 {
     void convert_angle(number& number, angle_unit from, angle_unit to);
 
+    // Units in a full turn for the angle unit forms of the trigonometric functions; not defined for radians.
+    unsigned long units_per_turn(angle_unit unit);
+
     using number_member_fn = void (number::*)(const number&);
+    using number_turn_fn = void (number::*)(const number&, unsigned long);
+
+    // Real mode domain predicates: whether a function maps a real argument to a real result. They are checked before
+    // evaluating, so real mode never computes a complex value only to reject it afterwards.
+    using real_domain_fn = bool (*)(const number&);
+
+    inline bool real_domain_any(const number&)
+    {
+        return true;
+    }
+
+    inline bool real_domain_nonnegative(const number& x)
+    {
+        return !x.is_negative();
+    }
+
+    inline bool real_domain_unit_interval(const number& x)
+    {
+        return !(x < -1) && !(x > 1);
+    }
+
+    inline bool real_domain_outside_unit_interval(const number& x)
+    {
+        return !(x > -1) || !(x < 1);
+    }
+
+    inline bool real_domain_at_least_one(const number& x)
+    {
+        return !(x < 1);
+    }
+
+    template<real_domain_fn RealDomain>
+    bool outside_real_domain(const number& x, const evaluator& eval)
+    {
+        return !eval.complex_mode() && !RealDomain(x);
+    }
 
-    template<number_member_fn Fn>
-    eval_error_type builtin1(evaluator::stack& stack, const evaluator&)
+    template<number_member_fn Fn, real_domain_fn RealDomain = &real_domain_any>
+    eval_error_type builtin1(evaluator::stack& stack, const evaluator& eval)
     {
+        if (outside_real_domain<RealDomain>(stack.back(), eval))
+            return eval_error_type::real_mode_complex_result;
         (stack.back().*Fn)(stack.back());
         return eval_error_type::none;
     }
 
-    template <number_member_fn Fn>
+    template <number_member_fn Fn, number_turn_fn TurnFn>
     eval_error_type builtin1_angle_argument(evaluator::stack& stack, const evaluator& eval)
     {
-        if (stack.back().is_real())
-            convert_angle(stack.back(), eval.trig_unit(), angle_unit::radians);
-        (stack.back().*Fn)(stack.back());
+        // Complex arguments are always taken in radians
+        if (stack.back().is_real() && eval.trig_unit() != angle_unit::radians)
+            (stack.back().*TurnFn)(stack.back(), units_per_turn(eval.trig_unit()));
+        else
+            (stack.back().*Fn)(stack.back());
         return eval_error_type::none;
     }
 
-    template <number_member_fn Fn>
+    // Applies an inverse trigonometric function. Real results come out in the evaluator's angle unit, computed directly
+    // in that unit when the argument is known to give a real result; complex results stay in radians.
+    template <number_member_fn Fn, number_turn_fn TurnFn, real_domain_fn RealDomain>
+    void angle_result(number& x, const evaluator& eval)
+    {
+        if (eval.trig_unit() != angle_unit::radians && x.is_real() && RealDomain(x))
+        {
+            (x.*TurnFn)(x, units_per_turn(eval.trig_unit()));
+            return;
+        }
+
+        (x.*Fn)(x);
+        if (x.is_real())
+            convert_angle(x, angle_unit::radians, eval.trig_unit());
+    }
+
+    template <number_member_fn Fn, number_turn_fn TurnFn, real_domain_fn RealDomain = &real_domain_any>
     eval_error_type builtin1_angle_result(evaluator::stack& stack, const evaluator& eval)
     {
-        (stack.back().*Fn)(stack.back());
-        if (stack.back().is_real())
-            convert_angle(stack.back(), angle_unit::radians, eval.trig_unit());
+        if (outside_real_domain<RealDomain>(stack.back(), eval))
+            return eval_error_type::real_mode_complex_result;
+        angle_result<Fn, TurnFn, RealDomain>(stack.back(), eval);
         return eval_error_type::none;
     }
 
@@ -48,6 +107,7 @@ namespace tcalc
     eval_error_type builtin_asec(evaluator::stack&, const evaluator&);
     eval_error_type builtin_acsc(evaluator::stack&, const evaluator&);
     eval_error_type builtin_acot(evaluator::stack&, const evaluator&);
+    eval_error_type builtin_arg(evaluator::stack&, const evaluator&);
     eval_error_type builtin_sech(evaluator::stack&, const evaluator&);
     eval_error_type builtin_csch(evaluator::stack&, const evaluator&);
     eval_error_type builtin_coth(evaluator::stack&, const evaluator&);
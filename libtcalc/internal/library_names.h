@@ -0,0 +1,15 @@
+#ifndef LIBRARY_NAMES_H
+#define LIBRARY_NAMES_H
+
+#include <span>
+#include <string_view>
+
+namespace tcalc::symbol_detail
+{
+    // Every name the library defines: the builtin functions, in the order of the evaluator's table, then the constants
+    // and Ans. The interner gives them the first ids as it is created, before any other name can be interned, so they
+    // always parse and builtin function i has id i.
+    std::span<const std::string_view> library_names();
+}
+
+#endif // LIBRARY_NAMES_H
@@ -0,0 +1,196 @@
+#include "snapshot.h"
+
+#include <cstddef>
+#include <cstring>
+
+#ifdef _MSC_VER
+#pragma warning(push, 0) // mpc header has warnings on MSVC /W4
+#endif
+
+#include <gmp.h>
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace tcalc;
+
+namespace
+{
+    constexpr char snapshot_magic[8] = {'t', 'c', 's', 'n', 'a', 'p', '0', '1'};
+    constexpr uint32_t byte_order_mark = 0x01020304;
+
+    struct file_header
+    {
+        char magic[8];
+        uint32_t byte_order;
+        uint32_t limb_size;
+        int64_t precision;
+        uint8_t complex_mode;
+        uint8_t trig_unit;
+        uint8_t reserved[6];
+        uint64_t count;
+    };
+
+    static_assert(sizeof(file_header) % 8 == 0);
+
+    size_t padded(const size_t size)
+    {
+        return (size + 7) & ~size_t{7};
+    }
+}
+
+snapshot_data::~snapshot_data()
+{
+#ifdef _WIN32
+    if (_mapped != nullptr)
+        UnmapViewOfFile(_mapped);
+    if (_mapping != nullptr)
+        CloseHandle(_mapping);
+    if (_file != nullptr)
+        CloseHandle(_file);
+#else
+    if (_mapped != nullptr)
+        munmap(const_cast<char*>(_mapped), _mapped_size);
+    if (_fd >= 0)
+        close(_fd);
+#endif
+}
+
+std::shared_ptr<const snapshot_data> snapshot_data::from_bytes(std::string&& bytes)
+{
+    auto snapshot = std::make_shared<snapshot_data>();
+    snapshot->_owned = std::move(bytes);
+    if (!snapshot->index(snapshot->_owned))
+        return nullptr;
+    return snapshot;
+}
+
+std::shared_ptr<const snapshot_data> snapshot_data::from_file(const std::string& path)
+{
+    auto snapshot = std::make_shared<snapshot_data>();
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return nullptr;
+    snapshot->_file = file;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+        return nullptr;
+    snapshot->_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (snapshot->_mapping == nullptr)
+        return nullptr;
+    snapshot->_mapped = static_cast<const char*>(MapViewOfFile(snapshot->_mapping, FILE_MAP_READ, 0, 0, 0));
+    if (snapshot->_mapped == nullptr)
+        return nullptr;
+    snapshot->_mapped_size = static_cast<size_t>(size.QuadPart);
+#else
+    snapshot->_fd = open(path.c_str(), O_RDONLY);
+    if (snapshot->_fd < 0)
+        return nullptr;
+    struct stat st{};
+    if (fstat(snapshot->_fd, &st) != 0 || st.st_size == 0)
+        return nullptr;
+    void* data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, snapshot->_fd, 0);
+    if (data == MAP_FAILED)
+        return nullptr;
+    snapshot->_mapped = static_cast<const char*>(data);
+    snapshot->_mapped_size = static_cast<size_t>(st.st_size);
+#endif
+
+    if (!snapshot->index({snapshot->_mapped, snapshot->_mapped_size}))
+        return nullptr;
+    return snapshot;
+}
+
+// Checks the whole layout and records where each value is, without decoding any of them.
+bool snapshot_data::index(std::string_view bytes)
+{
+    file_header header{};
+    if (bytes.size() < sizeof header)
+        return false;
+    std::memcpy(&header, bytes.data(), sizeof header);
+    bytes.remove_prefix(sizeof header);
+
+    if (std::memcmp(header.magic, snapshot_magic, sizeof snapshot_magic) != 0 || header.byte_order != byte_order_mark ||
+        header.limb_size != sizeof(mp_limb_t) || header.precision < 2 || header.precision > max_precision ||
+        header.trig_unit > static_cast<uint8_t>(angle_unit::gradians))
+        return false;
+
+    precision = static_cast<long>(header.precision);
+    complex_mode = header.complex_mode != 0;
+    trig_unit = static_cast<angle_unit>(header.trig_unit);
+
+    for (uint64_t i = 0; i < header.count; i++)
+    {
+        uint32_t name_length;
+        if (bytes.size() < sizeof name_length)
+            return false;
+        std::memcpy(&name_length, bytes.data(), sizeof name_length);
+
+        const size_t name_size = padded(sizeof name_length + name_length);
+        if (bytes.size() < name_size)
+            return false;
+        const auto name = symbol::try_intern(bytes.substr(sizeof name_length, name_length));
+        if (!name)
+            return false;
+        bytes.remove_prefix(name_size);
+
+        const size_t value_size = number::binary_size(bytes);
+        if (value_size == 0)
+            return false;
+        values.insert_or_assign(*name, bytes.substr(0, value_size));
+        bytes.remove_prefix(value_size);
+    }
+    return bytes.empty();
+}
+
+snapshot_writer::snapshot_writer(const long precision, const bool complex_mode, const angle_unit trig_unit)
+{
+    file_header header{};
+    std::memcpy(header.magic, snapshot_magic, sizeof snapshot_magic);
+    header.byte_order = byte_order_mark;
+    header.limb_size = sizeof(mp_limb_t);
+    header.precision = precision;
+    header.complex_mode = complex_mode ? 1 : 0;
+    header.trig_unit = static_cast<uint8_t>(trig_unit);
+    _bytes.append(reinterpret_cast<const char*>(&header), sizeof header);
+}
+
+void snapshot_writer::add_name(const symbol name)
+{
+    const std::string_view text = name.name();
+    const auto name_length = static_cast<uint32_t>(text.size());
+    _bytes.append(reinterpret_cast<const char*>(&name_length), sizeof name_length);
+    _bytes.append(text);
+    _bytes.resize(padded(_bytes.size()));
+    _count++;
+}
+
+void snapshot_writer::add(const symbol name, const number& value)
+{
+    add_name(name);
+    value.write_binary(_bytes);
+}
+
+void snapshot_writer::add_binary(const symbol name, const std::string_view image)
+{
+    add_name(name);
+    _bytes.append(image);
+}
+
+std::string snapshot_writer::finish()
+{
+    std::memcpy(_bytes.data() + offsetof(file_header, count), &_count, sizeof _count);
+    return std::move(_bytes);
+}
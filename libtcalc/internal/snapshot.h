@@ -0,0 +1,74 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "../tc_evaluator.h"
+
+namespace tcalc
+{
+    // A validated evaluator snapshot: settings plus the binary image of every variable, backed by a buffer read from
+    // a stream or by a read-only mapping of a file. Values stay in binary form until an evaluator reads them.
+    //
+    // Layout, in native byte order, with every record starting on an 8 byte boundary:
+    //   header: magic "tcsnap01", byte order mark, limb size, precision, complex mode, trig unit, variable count
+    //   per variable: name length (u32), name bytes, zero padding to 8, the number's binary image
+    class snapshot_data final
+    {
+    public:
+        snapshot_data() = default;
+        snapshot_data(const snapshot_data&) = delete;
+        snapshot_data& operator=(const snapshot_data&) = delete;
+        ~snapshot_data();
+
+        // Null if the bytes are not a snapshot written on a compatible machine.
+        static std::shared_ptr<const snapshot_data> from_bytes(std::string&& bytes);
+        static std::shared_ptr<const snapshot_data> from_file(const std::string& path);
+
+        // Larger precisions are rejected as damaged before anything is allocated for them.
+        static constexpr long max_precision = 1L << 24;
+
+        long precision = 0;
+        bool complex_mode = true;
+        angle_unit trig_unit = angle_unit::degrees;
+        symbol_table<std::string_view> values; // Views into the storage below
+
+    private:
+        bool index(std::string_view bytes);
+
+        std::string _owned;
+#ifdef _WIN32
+        void* _file = nullptr;
+        void* _mapping = nullptr;
+#else
+        int _fd = -1;
+#endif
+        const char* _mapped = nullptr;
+        size_t _mapped_size = 0;
+    };
+
+    // Builds a snapshot in memory; the variable count is filled in by finish().
+    class snapshot_writer final
+    {
+    public:
+        snapshot_writer(long precision, bool complex_mode, angle_unit trig_unit);
+
+        void add(symbol name, const number& value);
+
+        // Adds a value that is already a binary image, as stored in snapshot_data::values.
+        void add_binary(symbol name, std::string_view image);
+
+        std::string finish();
+
+    private:
+        void add_name(symbol name);
+
+        std::string _bytes;
+        uint64_t _count = 0;
+    };
+}
+
+#endif // SNAPSHOT_H
@@ -0,0 +1,57 @@
+#include "stats.h"
+
+#include <string_view>
+
+#include "../tc_evaluator_stats.h"
+
+using namespace tcalc;
+
+std::string_view tcalc::evaluator_phase_name(const evaluator_phase phase)
+{
+    using namespace std::string_view_literals;
+    switch (phase)
+    {
+        case evaluator_phase::arithmetic:
+            return "arithmetic"sv;
+        case evaluator_phase::boolean:
+            return "boolean"sv;
+        case evaluator_phase::assignment:
+            return "assignment"sv;
+        case evaluator_phase::function_call:
+            return "function_call"sv;
+        case evaluator_phase::commit:
+            return "commit"sv;
+    }
+    return "unknown"sv;
+}
+
+#ifdef TCALC_STATS
+
+thread_local stats_detail::number_counters stats_detail::number_counts{};
+
+stats_detail::counters_ptr::counters_ptr() : _counters{std::make_unique<evaluator_counters>()}
+{
+}
+
+stats_detail::counters_ptr::counters_ptr(const counters_ptr&) : counters_ptr()
+{
+}
+
+stats_detail::counters_ptr& stats_detail::counters_ptr::operator=(const counters_ptr&)
+{
+    return *this; // Counters belong to the evaluator object, not to its value
+}
+
+stats_detail::counters_ptr::counters_ptr(counters_ptr&& other) noexcept : _counters{std::move(other._counters)}
+{
+}
+
+stats_detail::counters_ptr& stats_detail::counters_ptr::operator=(counters_ptr&& other) noexcept
+{
+    _counters = std::move(other._counters);
+    return *this;
+}
+
+stats_detail::counters_ptr::~counters_ptr() = default;
+
+#endif
@@ -0,0 +1,112 @@
+#ifndef STATS_H
+#define STATS_H
+
+// TC_STATS(statement) runs the statement only when the library is built with TCALC_STATS, so that counting costs
+// nothing otherwise.
+#ifdef TCALC_STATS
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "../tc_eval_result.h"
+#include "../tc_evaluator_stats.h"
+#include "../tc_token.h"
+
+#define TC_STATS(...) __VA_ARGS__
+
+namespace tcalc::stats_detail
+{
+    constexpr size_t token_kind_count = static_cast<size_t>(token_kind::expression_separator) + 1;
+    constexpr size_t error_type_count = static_cast<size_t>(eval_error_type::nan_error) + 1;
+    constexpr size_t phase_count = static_cast<size_t>(evaluator_phase::commit) + 1;
+    constexpr size_t max_builtins = 64;
+
+    // Counted by number on whichever thread does the work; evaluators attribute the change over each of their phases.
+    struct number_counters
+    {
+        uint64_t constructions;
+        uint64_t copies;
+        uint64_t operations;
+        uint64_t pi_calls;
+    };
+
+    extern thread_local number_counters number_counts;
+
+    using counter = std::atomic<uint64_t>;
+
+    struct evaluator_counters
+    {
+        counter literals{0};
+        counter variables{0};
+        counter calls{0};
+        counter unary[token_kind_count]{};
+        counter binary[token_kind_count]{};
+        counter builtin_calls[max_builtins]{};
+        counter user_function_calls{0};
+        counter finite_check_failures[error_type_count]{};
+        counter constant_lookups{0};
+        counter variable_lookups{0};
+        counter snapshot_lookups{0};
+        counter undefined_lookups{0};
+        counter number_constructions{0};
+        counter number_copies{0};
+        counter number_operations{0};
+        counter number_pi_calls{0};
+        counter phase_calls[phase_count]{};
+        counter phase_ns[phase_count]{};
+    };
+
+    inline void bump(counter& c, const uint64_t by = 1)
+    {
+        c.fetch_add(by, std::memory_order_relaxed);
+    }
+
+    // Times one phase and, unless it nests inside another phase that does, attributes the number work done in it.
+    class phase_scope final
+    {
+    public:
+        phase_scope(evaluator_counters& counters, const evaluator_phase phase, const bool count_numbers) :
+            _counters{counters},
+            _phase{static_cast<size_t>(phase)},
+            _count_numbers{count_numbers},
+            _numbers_at_start{number_counts},
+            _start{std::chrono::steady_clock::now()}
+        {
+        }
+
+        phase_scope(const phase_scope&) = delete;
+        phase_scope& operator=(const phase_scope&) = delete;
+
+        ~phase_scope()
+        {
+            const auto elapsed = std::chrono::steady_clock::now() - _start;
+            bump(_counters.phase_calls[_phase]);
+            bump(_counters.phase_ns[_phase],
+                 static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+
+            if (_count_numbers)
+            {
+                bump(_counters.number_constructions, number_counts.constructions - _numbers_at_start.constructions);
+                bump(_counters.number_copies, number_counts.copies - _numbers_at_start.copies);
+                bump(_counters.number_operations, number_counts.operations - _numbers_at_start.operations);
+                bump(_counters.number_pi_calls, number_counts.pi_calls - _numbers_at_start.pi_calls);
+            }
+        }
+
+    private:
+        evaluator_counters& _counters;
+        size_t _phase;
+        bool _count_numbers;
+        number_counters _numbers_at_start;
+        std::chrono::steady_clock::time_point _start;
+    };
+}
+
+#else
+
+#define TC_STATS(...)
+
+#endif
+
+#endif // STATS_H
@@ -0,0 +1,247 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#include "../tc_trace.h"
+
+using namespace tcalc;
+using namespace tcalc::trace_detail;
+
+std::atomic<bool> trace_detail::enabled{false};
+
+namespace
+{
+    // Lexing is far finer grained than anything else traced, so consecutive tokens become one span
+    constexpr uint32_t max_lex_batch = 1024;
+
+    struct span_record
+    {
+        std::string_view name;
+        std::string_view arg_name;
+        int64_t arg;
+        uint64_t start;
+        uint64_t duration;
+    };
+
+    struct lex_batch
+    {
+        uint64_t start;
+        uint64_t duration;
+        uint32_t tokens;
+    };
+}
+
+// Written only by its own thread; readers wait for traced work to finish, so a release store of the count is enough.
+struct trace_detail::thread_buffer final
+{
+    uint32_t tid;
+    std::vector<span_record> spans;
+    std::atomic<uint64_t> written{0};
+    lex_batch pending{};
+};
+
+namespace
+{
+    struct registry
+    {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<thread_buffer>> buffers; // Kept after their threads exit, to be written
+        std::vector<thread_buffer*> released; // Buffers of exited threads, for new threads to take over
+        size_t capacity = 0;
+    };
+
+    // Never destroyed, as threads may still record during static destruction
+    registry& get_registry()
+    {
+        static auto* instance = new registry{};
+        return *instance;
+    }
+
+    std::atomic<int64_t> epoch_ns{0};
+
+    thread_local thread_buffer* current_buffer = nullptr;
+
+    // Hands the thread's buffer over to the next thread that records, once this one exits, so that a process starting
+    // many short-lived threads keeps as many buffers as it ever runs at once. The spans already in the buffer stay in
+    // its ring and are written along with those of the thread taking it over, under the same tid.
+    struct buffer_release final
+    {
+        ~buffer_release();
+    };
+
+    thread_local buffer_release release_on_exit;
+
+    void push(thread_buffer& buffer, const span_record& span)
+    {
+        const uint64_t index = buffer.written.load(std::memory_order_relaxed);
+        buffer.spans[index % buffer.spans.size()] = span;
+        buffer.written.store(index + 1, std::memory_order_release);
+    }
+
+    void flush_lex(thread_buffer& buffer)
+    {
+        if (buffer.pending.tokens == 0)
+            return;
+        push(buffer, {"lexer::next", "tokens", buffer.pending.tokens, buffer.pending.start, buffer.pending.duration});
+        buffer.pending = {};
+    }
+
+    void write_string(std::ostream& out, const std::string_view str)
+    {
+        out << '"';
+        for (const char c : str)
+        {
+            if (c == '"' || c == '\\')
+                out << '\\' << c;
+            else if (static_cast<unsigned char>(c) < 0x20)
+                out << std::format("\\u{:04x}", static_cast<unsigned>(c));
+            else
+                out << c;
+        }
+        out << '"';
+    }
+
+    // Chrome trace timestamps are in microseconds
+    std::string microseconds(const uint64_t ns)
+    {
+        return std::format("{}.{:03}", ns / 1000, ns % 1000);
+    }
+}
+
+buffer_release::~buffer_release()
+{
+    if (current_buffer == nullptr)
+        return;
+
+    auto& reg = get_registry();
+    std::scoped_lock lock{reg.mutex};
+    flush_lex(*current_buffer);
+    reg.released.push_back(current_buffer);
+    current_buffer = nullptr;
+}
+
+uint64_t trace_detail::now_ns()
+{
+    const auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    return static_cast<uint64_t>(now - epoch_ns.load(std::memory_order_relaxed));
+}
+
+thread_buffer* trace_detail::this_thread()
+{
+    if (current_buffer != nullptr)
+        return current_buffer;
+
+    auto& reg = get_registry();
+    std::scoped_lock lock{reg.mutex};
+    // Registers the release of the buffer when this thread exits
+    [[maybe_unused]] const auto* release = &release_on_exit;
+    if (!reg.released.empty())
+    {
+        current_buffer = reg.released.back();
+        reg.released.pop_back();
+        return current_buffer;
+    }
+
+    auto buffer = std::make_unique<thread_buffer>();
+    buffer->tid = static_cast<uint32_t>(reg.buffers.size() + 1);
+    buffer->spans.resize(reg.capacity);
+    current_buffer = buffer.get();
+    reg.buffers.push_back(std::move(buffer));
+    return current_buffer;
+}
+
+void trace_detail::record(thread_buffer& buffer, const std::string_view name, const uint64_t start, const uint64_t end,
+                          const std::string_view arg_name, const int64_t arg)
+{
+    flush_lex(buffer);
+    push(buffer, {name, arg_name, arg, start, end - start});
+}
+
+void trace_detail::record_lex(thread_buffer& buffer, const uint64_t start, const uint64_t end)
+{
+    auto& batch = buffer.pending;
+    if (batch.tokens == 0)
+        batch.start = start;
+    batch.duration += end - start;
+    if (++batch.tokens == max_lex_batch)
+        flush_lex(buffer);
+}
+
+void tcalc::start_tracing(const size_t spans_per_thread)
+{
+    auto& reg = get_registry();
+    std::scoped_lock lock{reg.mutex};
+    reg.capacity = std::max(spans_per_thread, size_t{1});
+    for (auto& buffer : reg.buffers)
+    {
+        buffer->spans.assign(reg.capacity, {});
+        buffer->written.store(0, std::memory_order_relaxed);
+        buffer->pending = {};
+    }
+
+    const auto epoch = std::chrono::steady_clock::now().time_since_epoch();
+    epoch_ns.store(std::chrono::duration_cast<std::chrono::nanoseconds>(epoch).count(), std::memory_order_relaxed);
+    enabled.store(true, std::memory_order_release);
+}
+
+void tcalc::stop_tracing()
+{
+    enabled.store(false, std::memory_order_release);
+}
+
+bool tcalc::tracing()
+{
+    return enabled.load(std::memory_order_acquire);
+}
+
+void tcalc::write_trace(std::ostream& out)
+{
+    auto& reg = get_registry();
+    std::scoped_lock lock{reg.mutex};
+
+    out << R"({"displayTimeUnit":"ns","traceEvents":[)";
+    bool first = true;
+    const auto separator = [&out, &first]
+    {
+        out << (first ? "\n" : ",\n");
+        first = false;
+    };
+
+    for (const auto& buffer : reg.buffers)
+    {
+        flush_lex(*buffer);
+        const uint64_t written = buffer->written.load(std::memory_order_acquire);
+        if (written == 0)
+            continue;
+
+        separator();
+        out << std::format(R"({{"name":"thread_name","ph":"M","pid":1,"tid":{},"args":{{"name":"tcalc thread {}"}}}})",
+                           buffer->tid, buffer->tid);
+
+        const uint64_t capacity = buffer->spans.size();
+        for (uint64_t i = written > capacity ? written - capacity : 0; i < written; i++)
+        {
+            const auto& span = buffer->spans[i % capacity];
+            separator();
+            out << R"({"name":)";
+            write_string(out, span.name);
+            out << std::format(R"(,"cat":"tcalc","ph":"X","pid":1,"tid":{},"ts":{},"dur":{})", buffer->tid,
+                               microseconds(span.start), microseconds(span.duration));
+            if (!span.arg_name.empty())
+            {
+                out << R"(,"args":{)";
+                write_string(out, span.arg_name);
+                out << ':' << span.arg << '}';
+            }
+            out << '}';
+        }
+    }
+    out << "\n]}\n";
+}
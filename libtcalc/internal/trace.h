@@ -0,0 +1,85 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <cstdint>
+#include <string_view>
+
+namespace tcalc::trace_detail
+{
+    // Checked with a relaxed load before anything else, so that tracing costs one predictable branch when it is off
+    extern std::atomic<bool> enabled;
+
+    struct thread_buffer;
+
+    thread_buffer* this_thread();
+    uint64_t now_ns();
+    void record(thread_buffer& buffer, std::string_view name, uint64_t start, uint64_t end, std::string_view arg_name,
+                int64_t arg);
+    void record_lex(thread_buffer& buffer, uint64_t start, uint64_t end);
+
+    // Records the time from its construction to its destruction as one span. Names must outlive the trace.
+    class span final
+    {
+    public:
+        explicit span(const std::string_view name, const std::string_view arg_name = {}, const int64_t arg = 0)
+        {
+            if (enabled.load(std::memory_order_relaxed)) [[unlikely]]
+                begin(name, arg_name, arg);
+        }
+
+        span(const span&) = delete;
+        span& operator=(const span&) = delete;
+
+        ~span()
+        {
+            if (_buffer != nullptr) [[unlikely]]
+                record(*_buffer, _name, _start, now_ns(), _arg_name, _arg);
+        }
+
+    private:
+        void begin(const std::string_view name, const std::string_view arg_name, const int64_t arg)
+        {
+            _buffer = this_thread();
+            _name = name;
+            _arg_name = arg_name;
+            _arg = arg;
+            _start = now_ns();
+        }
+
+        thread_buffer* _buffer = nullptr;
+        std::string_view _name;
+        std::string_view _arg_name;
+        int64_t _arg = 0;
+        uint64_t _start = 0;
+    };
+
+    // Adds the time spent lexing one token to the thread's current batch of lexed tokens.
+    class lex_span final
+    {
+    public:
+        lex_span()
+        {
+            if (enabled.load(std::memory_order_relaxed)) [[unlikely]]
+            {
+                _buffer = this_thread();
+                _start = now_ns();
+            }
+        }
+
+        lex_span(const lex_span&) = delete;
+        lex_span& operator=(const lex_span&) = delete;
+
+        ~lex_span()
+        {
+            if (_buffer != nullptr) [[unlikely]]
+                record_lex(*_buffer, _start, now_ns());
+        }
+
+    private:
+        thread_buffer* _buffer = nullptr;
+        uint64_t _start = 0;
+    };
+}
+
+#endif // TRACE_H
@@ -1,28 +1,29 @@
 #ifndef UTF8UTILS_H
 #define UTF8UTILS_H
 
+#include <cassert>
 #include <cstdint>
 #include <utility>
 #include <string>
+#include <string_view>
 
 #include <utf8proc.h>
 
 // Wrappers around utf8proc functions to make other code more readable
 namespace utf8utils
 {
-    inline std::pair<int, char32_t> iterate_one_from_index(const std::string& string, const size_t index)
-    {
-        char32_t character = U'\0';
-        const auto start_ptr = reinterpret_cast<const uint8_t*>(&string.at(index));
-        const auto len = utf8proc_iterate(start_ptr, -1, reinterpret_cast<int32_t*>(&character));
-        return {static_cast<int>(len), character};
-    }
-
     inline std::pair<int, char32_t> iterate_one_from_index(const std::string_view string, const size_t index)
     {
+        assert(index < string.length());
+        const auto start_ptr = reinterpret_cast<const uint8_t*>(string.data() + index);
+
+        // ASCII needs no decoding
+        if (*start_ptr < 0x80)
+            return {1, static_cast<char32_t>(*start_ptr)};
+
         char32_t character = U'\0';
-        const auto start_ptr = reinterpret_cast<const uint8_t*>(&string.at(index));
-        const auto len = utf8proc_iterate(start_ptr, -1, reinterpret_cast<int32_t*>(&character));
+        const auto remaining = static_cast<utf8proc_ssize_t>(string.length() - index);
+        const auto len = utf8proc_iterate(start_ptr, remaining, reinterpret_cast<int32_t*>(&character));
         return {static_cast<int>(len), character};
     }
 
@@ -0,0 +1,494 @@
+#include "tc_allocator.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#ifdef _MSC_VER
+#pragma warning(push, 0) // mpc header has warnings on MSVC /W4
+#endif
+
+#include <mpfr.h>
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#include "internal/allocator.h"
+
+using namespace tcalc;
+using namespace tcalc::allocator_detail;
+
+std::atomic<bool> allocator_detail::numbers_created{false};
+
+namespace
+{
+    // Sizes up to 1 KiB round up to a multiple of 16, so that the limbs of every precision below 8000 bits get a
+    // class of their own; larger sizes round up to a quarter of a power of two, wasting at most a fifth of the block.
+    constexpr size_t small_class_step = 16;
+    constexpr size_t small_class_limit = 1024;
+    constexpr size_t small_class_count = small_class_limit / small_class_step;
+    constexpr size_t classes_per_doubling = 4;
+    constexpr unsigned small_class_limit_log2 = 10;
+    constexpr unsigned largest_class_log2 = 20; // Anything larger goes straight to malloc
+    constexpr size_t class_count =
+        small_class_count + (largest_class_log2 - small_class_limit_log2) * classes_per_doubling;
+    constexpr size_t largest_class_size = size_t{1} << largest_class_log2;
+
+    // Each free list keeps at most this many bytes, or a few blocks of the largest classes, and hands the rest back
+    constexpr size_t free_list_bytes = 256 * 1024;
+    constexpr size_t min_free_list_blocks = 4;
+
+    constexpr size_t arena_alignment = 16;
+    constexpr size_t first_arena_chunk = 64 * 1024;
+
+    size_t size_class(const size_t size)
+    {
+        if (size <= small_class_limit)
+            return size == 0 ? 0 : (size - 1) / small_class_step;
+        const auto log2 = static_cast<unsigned>(std::bit_width(size - 1)) - 1; // 2^log2 < size <= 2^(log2 + 1)
+        const size_t step = size_t{1} << (log2 - 2);
+        const size_t quarter = (size - (size_t{1} << log2) - 1) / step;
+        return small_class_count + (log2 - small_class_limit_log2) * classes_per_doubling + quarter;
+    }
+
+    size_t class_size(const size_t size_class)
+    {
+        if (size_class < small_class_count)
+            return (size_class + 1) * small_class_step;
+        const size_t index = size_class - small_class_count;
+        const auto log2 = static_cast<unsigned>(small_class_limit_log2 + index / classes_per_doubling);
+        return (size_t{1} << log2) + (index % classes_per_doubling + 1) * (size_t{1} << (log2 - 2));
+    }
+
+    size_t free_list_capacity(const size_t size_class)
+    {
+        return std::max(min_free_list_blocks, free_list_bytes / class_size(size_class));
+    }
+
+    // GMP has no way to report a failed allocation, and aborts itself when its default allocator fails
+    [[noreturn]]
+    void out_of_memory()
+    {
+        std::fputs("tcalc: out of memory\n", stderr);
+        std::abort();
+    }
+
+    void* checked_malloc(const size_t size)
+    {
+        void* ptr = std::malloc(size);
+        if (ptr == nullptr)
+            out_of_memory();
+        return ptr;
+    }
+
+    struct free_block
+    {
+        free_block* next;
+    };
+
+    struct free_list
+    {
+        free_block* head = nullptr;
+        size_t length = 0;
+    };
+
+    using counter = std::atomic<uint64_t>;
+
+    // Written only by the owning thread, so adding needs no read-modify-write; other threads only read.
+    void add(counter& c, const uint64_t by)
+    {
+        c.store(c.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+    }
+
+    struct arena_chunk
+    {
+        char* data;
+        size_t size;
+    };
+
+    struct thread_arena
+    {
+        std::vector<arena_chunk> chunks;
+        size_t chunk = 0; // Chunk being bumped
+        size_t used = 0;
+        void* last = nullptr; // Latest allocation, which can grow or be given back in place
+        bool owned = false;
+        bool serving = false;
+
+        [[nodiscard]]
+        bool contains(const void* ptr) const
+        {
+            const auto* p = static_cast<const char*>(ptr);
+            return std::any_of(chunks.begin(), chunks.end(),
+                               [p](const arena_chunk& c) { return p >= c.data && p < c.data + c.size; });
+        }
+
+        void reset()
+        {
+            chunk = 0;
+            used = 0;
+            last = nullptr;
+        }
+    };
+
+    std::atomic<bool> installed{false};
+}
+
+struct allocator_detail::thread_state final
+{
+    free_list lists[class_count];
+    thread_arena arena;
+    counter bytes_allocated{0};
+    counter bytes_freed{0};
+    counter free_list_hits{0};
+    counter free_list_misses{0};
+    counter arena_bytes_allocated{0};
+    counter arena_resets{0};
+
+    thread_state();
+    thread_state(const thread_state&) = delete;
+    thread_state& operator=(const thread_state&) = delete;
+    ~thread_state();
+
+    void* allocate(size_t size);
+    void* allocate_from_arena(size_t size);
+    void* reallocate(void* ptr, size_t old_size, size_t new_size);
+    void deallocate(void* ptr, size_t size);
+};
+
+namespace
+{
+    struct registry
+    {
+        std::mutex mutex;
+        std::vector<thread_state*> threads;
+        allocator_stats exited{};
+    };
+
+    // Never destroyed, as threads may still exit during static destruction
+    registry& get_registry()
+    {
+        static auto* instance = new registry{};
+        return *instance;
+    }
+
+    // Both trivially destructible, so they can still be read once the thread's state has been destroyed
+    thread_local thread_state* current_state = nullptr;
+    thread_local bool thread_state_destroyed = false;
+
+    thread_state* create_thread_state()
+    {
+        if (thread_state_destroyed)
+            return nullptr;
+        thread_local thread_state state;
+        return current_state = &state;
+    }
+
+    thread_state* this_thread()
+    {
+        return current_state != nullptr ? current_state : create_thread_state();
+    }
+
+    void* gmp_allocate(const size_t size)
+    {
+        if (auto* state = this_thread())
+            return state->allocate(size);
+        return checked_malloc(size > largest_class_size ? size : class_size(size_class(size)));
+    }
+
+    void* gmp_reallocate(void* ptr, const size_t old_size, const size_t new_size)
+    {
+        if (auto* state = this_thread())
+            return state->reallocate(ptr, old_size, new_size);
+
+        // Blocks are only ever pooled at their class size, so a block is safe to hand back to malloc as is
+        void* moved = gmp_allocate(new_size);
+        std::memcpy(moved, ptr, std::min(old_size, new_size));
+        std::free(ptr);
+        return moved;
+    }
+
+    void gmp_free(void* ptr, const size_t size)
+    {
+        if (auto* state = this_thread())
+            state->deallocate(ptr, size);
+        else
+            std::free(ptr);
+    }
+}
+
+thread_state::thread_state()
+{
+    auto& reg = get_registry();
+    std::scoped_lock lock{reg.mutex};
+    reg.threads.push_back(this);
+}
+
+thread_state::~thread_state()
+{
+    // MPFR never frees the caches and pools of exiting threads itself; they come back here while the lists still work
+    mpfr_mp_memory_cleanup();
+
+    for (auto& list : lists)
+    {
+        while (list.head != nullptr)
+        {
+            auto* next = list.head->next;
+            std::free(list.head);
+            list.head = next;
+        }
+    }
+    for (const auto& chunk : arena.chunks)
+        std::free(chunk.data);
+
+    {
+        auto& reg = get_registry();
+        std::scoped_lock lock{reg.mutex};
+        reg.exited.bytes_allocated += bytes_allocated.load(std::memory_order_relaxed);
+        reg.exited.bytes_freed += bytes_freed.load(std::memory_order_relaxed);
+        reg.exited.free_list_hits += free_list_hits.load(std::memory_order_relaxed);
+        reg.exited.free_list_misses += free_list_misses.load(std::memory_order_relaxed);
+        reg.exited.arena_bytes_allocated += arena_bytes_allocated.load(std::memory_order_relaxed);
+        reg.exited.arena_resets += arena_resets.load(std::memory_order_relaxed);
+        std::erase(reg.threads, this);
+    }
+    current_state = nullptr;
+    thread_state_destroyed = true;
+}
+
+void* thread_state::allocate(const size_t size)
+{
+    if (arena.serving)
+        return allocate_from_arena(size);
+
+    add(bytes_allocated, size);
+    if (size > largest_class_size)
+    {
+        add(free_list_misses, 1);
+        return checked_malloc(size);
+    }
+
+    auto& list = lists[size_class(size)];
+    if (list.head == nullptr)
+    {
+        add(free_list_misses, 1);
+        return checked_malloc(class_size(size_class(size)));
+    }
+
+    add(free_list_hits, 1);
+    auto* block = list.head;
+    list.head = block->next;
+    list.length--;
+    return block;
+}
+
+void* thread_state::allocate_from_arena(size_t size)
+{
+    size = (std::max(size, size_t{1}) + arena_alignment - 1) & ~(arena_alignment - 1);
+    add(arena_bytes_allocated, size);
+    while (true)
+    {
+        if (arena.chunk < arena.chunks.size())
+        {
+            const auto& chunk = arena.chunks[arena.chunk];
+            if (chunk.size - arena.used >= size)
+            {
+                void* ptr = chunk.data + arena.used;
+                arena.used += size;
+                arena.last = ptr;
+                return ptr;
+            }
+            if (arena.chunk + 1 < arena.chunks.size())
+            {
+                arena.chunk++;
+                arena.used = 0;
+                continue;
+            }
+        }
+
+        // Out of chunks: each new one is twice as large as the last, so an evaluation needs few of them
+        const size_t previous = arena.chunks.empty() ? first_arena_chunk / 2 : arena.chunks.back().size;
+        const size_t chunk_size = std::max(previous * 2, size);
+        arena.chunks.push_back({static_cast<char*>(checked_malloc(chunk_size)), chunk_size});
+        arena.chunk = arena.chunks.size() - 1;
+        arena.used = 0;
+    }
+}
+
+void* thread_state::reallocate(void* ptr, const size_t old_size, const size_t new_size)
+{
+    if (arena.contains(ptr))
+    {
+        if (arena.serving && ptr == arena.last)
+        {
+            const auto& chunk = arena.chunks[arena.chunk];
+            const size_t start = static_cast<size_t>(static_cast<char*>(ptr) - chunk.data);
+            const size_t grown = (std::max(new_size, size_t{1}) + arena_alignment - 1) & ~(arena_alignment - 1);
+            if (chunk.size - start >= grown)
+            {
+                if (start + grown > arena.used)
+                    add(arena_bytes_allocated, start + grown - arena.used);
+                arena.used = start + grown;
+                return ptr;
+            }
+        }
+        void* moved = allocate(new_size);
+        std::memcpy(moved, ptr, std::min(old_size, new_size));
+        return moved;
+    }
+
+    // Blocks from before the arena was opened, such as MPFR's caches, stay on the heap
+    if (old_size <= largest_class_size && new_size <= largest_class_size &&
+        size_class(old_size) == size_class(new_size))
+    {
+        add(bytes_allocated, new_size);
+        add(bytes_freed, old_size);
+        return ptr;
+    }
+    if (old_size > largest_class_size && new_size > largest_class_size)
+    {
+        add(bytes_allocated, new_size);
+        add(bytes_freed, old_size);
+        void* moved = std::realloc(ptr, new_size);
+        if (moved == nullptr)
+            out_of_memory();
+        return moved;
+    }
+
+    const bool was_serving = arena.serving;
+    arena.serving = false;
+    void* moved = allocate(new_size);
+    arena.serving = was_serving;
+    std::memcpy(moved, ptr, std::min(old_size, new_size));
+    deallocate(ptr, old_size);
+    return moved;
+}
+
+void thread_state::deallocate(void* ptr, const size_t size)
+{
+    if (ptr == nullptr)
+        return;
+    if (!arena.chunks.empty() && arena.contains(ptr))
+    {
+        if (ptr == arena.last)
+        {
+            arena.used = static_cast<size_t>(static_cast<char*>(ptr) - arena.chunks[arena.chunk].data);
+            arena.last = nullptr;
+        }
+        return;
+    }
+
+    add(bytes_freed, size);
+    if (size > largest_class_size)
+    {
+        std::free(ptr);
+        return;
+    }
+
+    const size_t index = size_class(size);
+    auto& list = lists[index];
+    if (list.length >= free_list_capacity(index))
+    {
+        std::free(ptr);
+        return;
+    }
+
+    auto* block = static_cast<free_block*>(ptr);
+    block->next = list.head;
+    list.head = block;
+    list.length++;
+}
+
+arena_scope::arena_scope()
+{
+    if (!installed.load(std::memory_order_acquire))
+        return;
+    auto* state = this_thread();
+    if (state == nullptr || state->arena.owned)
+        return;
+
+    state->arena.owned = true;
+    state->arena.serving = true;
+    _state = state;
+}
+
+void arena_scope::release()
+{
+    if (_state != nullptr)
+        _state->arena.serving = false;
+}
+
+arena_scope::~arena_scope()
+{
+    if (_state == nullptr)
+        return;
+
+    _state->arena.serving = false;
+    // MPFR's constant caches and pool of integers outlive calls and may hold memory from the arena
+    mpfr_mp_memory_cleanup();
+    _state->arena.reset();
+    add(_state->arena_resets, 1);
+    _state->arena.owned = false;
+}
+
+arena_pause::arena_pause()
+{
+    if (!installed.load(std::memory_order_acquire))
+        return;
+    auto* state = this_thread();
+    if (state == nullptr || !state->arena.serving)
+        return;
+
+    state->arena.serving = false;
+    _state = state;
+}
+
+arena_pause::~arena_pause()
+{
+    if (_state != nullptr)
+        _state->arena.serving = true;
+}
+
+void tcalc::install_allocator()
+{
+    static std::mutex install_mutex;
+    std::scoped_lock lock{install_mutex};
+    if (installed.load(std::memory_order_relaxed))
+        return;
+    if (numbers_created.load(std::memory_order_relaxed))
+        throw std::logic_error{"install_allocator must be called before the first number is created"};
+
+    // MPFR requires its caches and pools to be empty before the memory functions change
+    mpfr_mp_memory_cleanup();
+    mp_set_memory_functions(&gmp_allocate, &gmp_reallocate, &gmp_free);
+    installed.store(true, std::memory_order_release);
+}
+
+bool tcalc::allocator_installed()
+{
+    return installed.load(std::memory_order_acquire);
+}
+
+allocator_stats tcalc::get_allocator_stats()
+{
+    auto& reg = get_registry();
+    std::scoped_lock lock{reg.mutex};
+    allocator_stats stats = reg.exited;
+    for (const auto* state : reg.threads)
+    {
+        stats.bytes_allocated += state->bytes_allocated.load(std::memory_order_relaxed);
+        stats.bytes_freed += state->bytes_freed.load(std::memory_order_relaxed);
+        stats.free_list_hits += state->free_list_hits.load(std::memory_order_relaxed);
+        stats.free_list_misses += state->free_list_misses.load(std::memory_order_relaxed);
+        stats.arena_bytes_allocated += state->arena_bytes_allocated.load(std::memory_order_relaxed);
+        stats.arena_resets += state->arena_resets.load(std::memory_order_relaxed);
+    }
+    return stats;
+}
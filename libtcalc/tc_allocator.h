@@ -0,0 +1,35 @@
+#ifndef TC_ALLOCATOR_H
+#define TC_ALLOCATOR_H
+
+#include <cstdint>
+
+namespace tcalc
+{
+    // Memory handed out to GMP, MPFR and MPC by the allocator installed with install_allocator, summed over all
+    // threads, including threads that have exited. Arena bytes are counted in neither bytes_allocated nor bytes_freed.
+    struct allocator_stats final
+    {
+        uint64_t bytes_allocated;
+        uint64_t bytes_freed;
+        uint64_t free_list_hits; // Allocations served from a free list instead of malloc
+        uint64_t free_list_misses;
+        uint64_t arena_bytes_allocated;
+        uint64_t arena_resets;
+    };
+
+    // Routes all GMP, MPFR and MPC memory through per-thread free lists, one per size class, so that the numbers
+    // created and destroyed by each evaluation reuse their limbs instead of going to malloc. Blocks freed on another
+    // thread than the one that allocated them join that thread's free lists. Must be called before the first number
+    // is created, as blocks from the default allocator cannot be told apart from pooled ones; throws
+    // std::logic_error otherwise. Calling it again does nothing. The allocator stays installed for the rest of the
+    // process.
+    void install_allocator();
+
+    [[nodiscard]]
+    bool allocator_installed();
+
+    [[nodiscard]]
+    allocator_stats get_allocator_stats();
+}
+
+#endif // TC_ALLOCATOR_H
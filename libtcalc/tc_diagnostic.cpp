@@ -13,6 +13,10 @@ std::string_view tcalc::diagnostic_type_name(const diagnostic_type type)
             return "invalid_symbol"sv;
         case diagnostic_type::unexpected_token:
             return "unexpected_token"sv;
+        case diagnostic_type::nesting_too_deep:
+            return "nesting_too_deep"sv;
+        case diagnostic_type::too_many_symbols:
+            return "too_many_symbols"sv;
         default:
             return {};
     }
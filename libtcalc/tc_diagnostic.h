@@ -15,7 +15,9 @@ namespace tcalc
         bad_character,
         invalid_number_literal,
         invalid_symbol,
-        unexpected_token
+        unexpected_token,
+        nesting_too_deep,
+        too_many_symbols
     };
 
     std::string_view diagnostic_type_name(diagnostic_type type);
@@ -6,6 +6,7 @@
 
 #include "tc_source_position.h"
 #include "tc_number.h"
+#include "tc_symbol.h"
 
 namespace tcalc
 {
@@ -49,7 +50,7 @@ namespace tcalc
 
     struct assign_result final
     {
-        std::string variable;
+        symbol variable;
         number value;
     };
 
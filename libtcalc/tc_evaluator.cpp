@@ -1,5 +1,9 @@
 #include "tc_evaluator.h"
 
+#include <algorithm>
+#include <array>
+#include <istream>
+#include <ostream>
 #include <stdexcept>
 
 #ifdef _MSC_VER
@@ -13,74 +17,131 @@
 #endif
 
 #include "tc_eval_result.h"
+#include "internal/allocator.h"
 #include "internal/builtins.h"
+#include "internal/library_names.h"
+#include "internal/snapshot.h"
+#include "internal/stats.h"
+#include "internal/trace.h"
 
 using namespace tcalc;
 
+TC_STATS(using namespace tcalc::stats_detail;)
+
 // TODO: Make sure root implementations are correct & match for all cases.
 
 namespace
 {
-    using namespace std::string_literals;
     using namespace std::string_view_literals;
 
-    std::map<std::string, number> initialize_constants(const mpfr_prec_t prec)
+    constexpr std::string_view ans_name = "Ans"sv;
+    constexpr std::string_view pi_names[] = {"pi"sv, "π"sv};
+    constexpr std::string_view tau_names[] = {"tau"sv, "τ"sv};
+    constexpr std::string_view e_name = "e"sv;
+
+    symbol ans_symbol()
+    {
+        static const symbol ans{ans_name};
+        return ans;
+    }
+
+    symbol_table<number> initialize_constants(const mpfr_prec_t prec)
     {
-        return {
-            {"pi"s, number::pi(prec)},
-            {"π"s, number::pi(prec)},
-            {"tau"s, number::tau(prec)},
-            {"τ"s, number::tau(prec)},
-            {"e"s, number::e(prec)}
-        };
+        symbol_table<number> constants;
+        for (const std::string_view pi : pi_names)
+            constants.insert_or_assign(symbol{pi}, number::pi(prec));
+        for (const std::string_view tau : tau_names)
+            constants.insert_or_assign(symbol{tau}, number::tau(prec));
+        constants.insert_or_assign(symbol{e_name}, number::e(prec));
+        return constants;
     }
 
-    std::map<std::string, std::vector<evaluator::native_fn>> basic_builtins()
+    struct builtin_overload
+    {
+        fn_arity_t arity;
+        evaluator::native_fn_ptr fn;
+    };
+
+    struct builtin_function
+    {
+        std::string_view name;
+        builtin_overload overloads[2]; // Unused slots have a null fn
+    };
+
+    constexpr builtin_function builtin_functions[] =
     {
-        return
+        {"sqrt"sv, {{1, &builtin_sqrt}}},
+        {"cbrt"sv, {{1, &builtin_cbrt}}},
+        {"root"sv, {{2, &builtin_root}}},
+        {"exp"sv, {{1, &builtin1<&number::exp>}}},
         {
-            {"sqrt"s, {{1, &builtin_sqrt}}},
-            {"cbrt"s, {{1, &builtin_cbrt}}},
-            {"root"s, {{2, &builtin_root}}},
-            {"exp"s, {{1, &builtin1<&number::exp>}}},
+            "log"sv,
             {
-                "log"s,
-                {
-                    {1, &builtin_log1},
-                    {2, &builtin_log2}
-                }
-            },
-            {"ln"s, {{1, &builtin_ln}}},
-            {"sin"s, {{1, &builtin1_angle_argument<&number::sin>}}},
-            {"cos"s, {{1, &builtin1_angle_argument<&number::cos>}}},
-            {"tan"s, {{1, &builtin_tan}}},
-            {"sec"s, {{1, &builtin_sec}}},
-            {"csc"s, {{1, &builtin_csc}}},
-            {"cot"s, {{1, &builtin_cot}}},
-            {"asin"s, {{1, &builtin1_angle_result<&number::asin>}}},
-            {"acos"s, {{1, &builtin1_angle_result<&number::acos>}}},
-            {"atan"s, {{1, &builtin1_angle_result<&number::atan>}}},
-            {"asec"s, {{1, &builtin_asec}}},
-            {"acsc"s, {{1, &builtin_acsc}}},
-            {"acot"s, {{1, &builtin_acot}}},
-            {"sinh"s, {{1, &builtin1<&number::sinh>}}},
-            {"cosh"s, {{1, &builtin1<&number::cosh>}}},
-            {"tanh"s, {{1, &builtin1<&number::tanh>}}},
-            {"sech"s, {{1, &builtin_sech}}},
-            {"csch"s, {{1, &builtin_csch}}},
-            {"coth"s, {{1, &builtin_coth}}},
-            {"asinh"s, {{1, &builtin1<&number::asinh>}}},
-            {"acosh"s, {{1, &builtin1<&number::acosh>}}},
-            {"atanh"s, {{1, &builtin1<&number::atanh>}}},
-            {"asech"s, {{1, &builtin_asech}}},
-            {"acsch"s, {{1, &builtin_acsch}}},
-            {"acoth"s, {{1, &builtin_acoth}}},
-            {"abs"s, {{1, &builtin1<&number::abs>}}},
-            {"re"s, {{1, &builtin1<&number::re>}}},
-            {"im"s, {{1, &builtin1<&number::im>}}},
-            {"arg"s, {{1, &builtin1_angle_result<&number::arg>}}},
-            {"conj"s, {{1, &builtin1<&number::conj>}}}
-        };
+                {1, &builtin_log1},
+                {2, &builtin_log2}
+            }
+        },
+        {"ln"sv, {{1, &builtin_ln}}},
+        {"sin"sv, {{1, &builtin1_angle_argument<&number::sin, &number::sin>}}},
+        {"cos"sv, {{1, &builtin1_angle_argument<&number::cos, &number::cos>}}},
+        {"tan"sv, {{1, &builtin_tan}}},
+        {"sec"sv, {{1, &builtin_sec}}},
+        {"csc"sv, {{1, &builtin_csc}}},
+        {"cot"sv, {{1, &builtin_cot}}},
+        {"asin"sv, {{1, &builtin1_angle_result<&number::asin, &number::asin, &real_domain_unit_interval>}}},
+        {"acos"sv, {{1, &builtin1_angle_result<&number::acos, &number::acos, &real_domain_unit_interval>}}},
+        {"atan"sv, {{1, &builtin1_angle_result<&number::atan, &number::atan>}}},
+        {"asec"sv, {{1, &builtin_asec}}},
+        {"acsc"sv, {{1, &builtin_acsc}}},
+        {"acot"sv, {{1, &builtin_acot}}},
+        {"sinh"sv, {{1, &builtin1<&number::sinh>}}},
+        {"cosh"sv, {{1, &builtin1<&number::cosh>}}},
+        {"tanh"sv, {{1, &builtin1<&number::tanh>}}},
+        {"sech"sv, {{1, &builtin_sech}}},
+        {"csch"sv, {{1, &builtin_csch}}},
+        {"coth"sv, {{1, &builtin_coth}}},
+        {"asinh"sv, {{1, &builtin1<&number::asinh>}}},
+        {"acosh"sv, {{1, &builtin1<&number::acosh, &real_domain_at_least_one>}}},
+        {"atanh"sv, {{1, &builtin1<&number::atanh, &real_domain_unit_interval>}}},
+        {"asech"sv, {{1, &builtin_asech}}},
+        {"acsch"sv, {{1, &builtin_acsch}}},
+        {"acoth"sv, {{1, &builtin_acoth}}},
+        {"abs"sv, {{1, &builtin1<&number::abs>}}},
+        {"re"sv, {{1, &builtin1<&number::re>}}},
+        {"im"sv, {{1, &builtin1<&number::im>}}},
+        {"arg"sv, {{1, &builtin_arg}}},
+        {"conj"sv, {{1, &builtin1<&number::conj>}}}
+    };
+
+    // Listed for the interner by symbol_detail::library_names
+    constexpr auto all_library_names = []
+    {
+        std::array<std::string_view, std::size(builtin_functions) + 6> names{};
+        auto out = std::ranges::transform(builtin_functions, names.begin(), &builtin_function::name).out;
+        *out++ = ans_name;
+        out = std::ranges::copy(pi_names, out).out;
+        out = std::ranges::copy(tau_names, out).out;
+        *out = e_name;
+        return names;
+    }();
+
+    static_assert([]
+    {
+        for (size_t i = 0; i < all_library_names.size(); i++)
+        {
+            for (size_t j = i + 1; j < all_library_names.size(); j++)
+            {
+                if (all_library_names[i] == all_library_names[j])
+                    return false;
+            }
+        }
+        return true;
+    }(), "every library name must be distinct for builtin i to get id i");
+
+    // The interner gives the builtin names the first ids, in table order, so an id indexes the table directly.
+    const builtin_function* find_builtin(const symbol sym)
+    {
+        return sym.id() < std::size(builtin_functions) ? &builtin_functions[sym.id()] : nullptr;
     }
 
     eval_result<evaluator::result_type> to_variant_result(eval_result<number>&& e)
@@ -117,14 +178,70 @@ namespace
 
 } // End anonymous namespace
 
+std::span<const std::string_view> symbol_detail::library_names()
+{
+    return all_library_names;
+}
+
 evaluator::evaluator(const long precision) :
     _precision{precision},
-    _constants{initialize_constants(_precision)},
-    _native_fns{basic_builtins()}
+    _constants{initialize_constants(_precision)}
+{
+}
+
+std::vector<std::pair<std::string_view, fn_arity_t>> evaluator::builtin_signatures()
+{
+    std::vector<std::pair<std::string_view, fn_arity_t>> signatures;
+    for (const auto& [name, overloads] : builtin_functions)
+    {
+        for (const auto& [arity, fn] : overloads)
+        {
+            if (fn != nullptr)
+                signatures.emplace_back(name, arity);
+        }
+    }
+    return signatures;
+}
+
+void evaluator::define_function(const std::string_view name, const fn_arity_t arity,
+                                std::function<eval_error_type(stack&, const evaluator&)> fn)
 {
+    const symbol sym{name};
+    auto* overloads = _user_fns.find(sym);
+    if (overloads == nullptr)
+    {
+        _user_fns.insert_or_assign(sym, {{arity, std::move(fn)}});
+        return;
+    }
+
+    for (auto& overload : *overloads)
+    {
+        if (overload.arity == arity)
+        {
+            overload.fn = std::move(fn);
+            return;
+        }
+    }
+    overloads->push_back({arity, std::move(fn)});
 }
 
 eval_result<evaluator::result_type> evaluator::evaluate(const expression& expr) const
+{
+    if (!_arena_mode)
+        return evaluate_expression(expr);
+
+    allocator_detail::arena_scope arena;
+    auto result = evaluate_expression(expr);
+    if (!arena.owns_arena())
+        return result;
+
+    // The arena is reset as soon as the scope ends, taking the result's limbs with it
+    arena.release();
+    eval_result<result_type> copy{result};
+    return copy;
+}
+
+eval_result<evaluator::result_type> evaluator::evaluate_expression(const expression& expr) const
 {
     if (const auto* arith = std::get_if<arithmetic_expression>(&expr))
         return to_variant_result(evaluate_arithmetic(*arith));
@@ -138,45 +255,204 @@ eval_result<evaluator::result_type> evaluator::evaluate(const expression& expr)
 
 void evaluator::commit_result(const result_type& result)
 {
+    TC_STATS(phase_scope phase{*_counters, evaluator_phase::commit, true});
     if (const auto* num = std::get_if<number>(&result))
-        _variables.insert_or_assign("Ans", *num);
+        _variables.insert_or_assign(ans_symbol(), *num);
     else if (const auto* asgn = std::get_if<assign_result>(&result))
         _variables.insert_or_assign(asgn->variable, asgn->value);
 }
 
+evaluator_stats evaluator::stats() const
+{
+    return read_stats(false);
+}
+
+evaluator_stats evaluator::take_stats()
+{
+    return read_stats(true);
+}
+
+evaluator_stats evaluator::read_stats([[maybe_unused]] const bool reset) const
+{
+    evaluator_stats stats;
+#ifdef TCALC_STATS
+    const auto read = [reset](counter& c)
+    {
+        return reset ? c.exchange(0, std::memory_order_relaxed) : c.load(std::memory_order_relaxed);
+    };
+
+    if (const uint64_t literals = read(_counters->literals))
+        stats.operations.emplace_back("literal", literals);
+    if (const uint64_t variables = read(_counters->variables))
+        stats.operations.emplace_back("variable", variables);
+    if (const uint64_t calls = read(_counters->calls))
+        stats.operations.emplace_back("call", calls);
+    for (size_t kind = 0; kind < token_kind_count; kind++)
+    {
+        const std::string_view name = token_kind_name(static_cast<token_kind>(kind));
+        if (const uint64_t count = read(_counters->unary[kind]))
+            stats.operations.emplace_back(std::string{"unary:"} + std::string{name}, count);
+        if (const uint64_t count = read(_counters->binary[kind]))
+            stats.operations.emplace_back(std::string{"binary:"} + std::string{name}, count);
+    }
+
+    static_assert(std::size(builtin_functions) <= max_builtins);
+    for (size_t i = 0; i < std::size(builtin_functions); i++)
+    {
+        if (const uint64_t count = read(_counters->builtin_calls[i]))
+            stats.builtin_calls.emplace_back(builtin_functions[i].name, count);
+    }
+
+    for (size_t type = 0; type < error_type_count; type++)
+    {
+        if (const uint64_t count = read(_counters->finite_check_failures[type]))
+            stats.finite_check_failures.emplace_back(eval_error_type_name(static_cast<eval_error_type>(type)), count);
+    }
+
+    stats.user_function_calls = read(_counters->user_function_calls);
+    stats.constant_lookups = read(_counters->constant_lookups);
+    stats.variable_lookups = read(_counters->variable_lookups);
+    stats.snapshot_lookups = read(_counters->snapshot_lookups);
+    stats.undefined_lookups = read(_counters->undefined_lookups);
+    stats.number_constructions = read(_counters->number_constructions);
+    stats.number_copies = read(_counters->number_copies);
+    stats.number_operations = read(_counters->number_operations);
+    stats.number_pi_calls = read(_counters->number_pi_calls);
+
+    for (size_t phase = 0; phase < phase_count; phase++)
+    {
+        stats.phases.push_back({
+            .phase = evaluator_phase_name(static_cast<evaluator_phase>(phase)),
+            .calls = read(_counters->phase_calls[phase]),
+            .seconds = static_cast<double>(read(_counters->phase_ns[phase])) * 1e-9
+        });
+    }
+#endif
+    return stats;
+}
+
+void evaluator::save(std::ostream& out) const
+{
+    snapshot_writer writer{_precision, _complex_mode, _trig_unit};
+    _variables.for_each([&writer](const symbol name, const number& value)
+    {
+        writer.add(name, value);
+    });
+    if (_snapshot != nullptr)
+    {
+        _snapshot->values.for_each([&](const symbol name, const std::string_view image)
+        {
+            if (!_variables.contains(name))
+                writer.add_binary(name, image); // Copied without decoding
+        });
+    }
+
+    const std::string bytes = writer.finish();
+    out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+bool evaluator::load(std::istream& in)
+{
+    std::string bytes;
+    char block[1 << 16];
+    while (in.read(block, sizeof block) || in.gcount() > 0)
+        bytes.append(block, static_cast<size_t>(in.gcount()));
+    return load_snapshot(snapshot_data::from_bytes(std::move(bytes)));
+}
+
+bool evaluator::load_file(const std::string& path)
+{
+    return load_snapshot(snapshot_data::from_file(path));
+}
+
+bool evaluator::load_snapshot(std::shared_ptr<const snapshot_data> snapshot)
+{
+    if (snapshot == nullptr)
+        return false;
+
+    if (snapshot->precision != _precision)
+    {
+        _precision = snapshot->precision;
+        _constants = initialize_constants(_precision);
+    }
+    _complex_mode = snapshot->complex_mode;
+    _trig_unit = snapshot->trig_unit;
+    _variables.clear();
+    _snapshot = std::move(snapshot);
+    _snapshot_decoded.clear();
+    return true;
+}
+
+const number* evaluator::decode_snapshot_variable(const symbol name) const
+{
+    const std::string_view* image = _snapshot->values.find(name);
+    if (image == nullptr)
+        return nullptr;
+
+    const allocator_detail::arena_pause pause; // The decoded value outlives this evaluation
+    std::string_view data = *image;
+    number value{_precision};
+    value.read_binary(data); // Validated when loaded
+    _snapshot_decoded.insert_or_assign(name, std::move(value));
+    return _snapshot_decoded.find(name);
+}
+
 eval_result<number> evaluator::evaluate_arithmetic(const arithmetic_expression& expr) const
 {
+    TC_STATS(phase_scope phase{*_counters, evaluator_phase::arithmetic, true});
+    trace_detail::span trace{"evaluator::evaluate_arithmetic", "operations", static_cast<int64_t>(expr.tokens.size())};
     stack stack;
+    stack.reserve(expr.max_stack_depth);
 
     for (auto& op : expr.tokens)
     {
         if (const auto* numop = std::get_if<literal_number>(&op))
         {
+            TC_STATS(bump(_counters->literals));
             stack.push_back(numop->num);
             const eval_error_type err = check_finite(stack.back(), _complex_mode);
             if (err != eval_error_type::none)
+            {
+                TC_STATS(bump(_counters->finite_check_failures[static_cast<size_t>(err)]));
                 return eval_result<number>{err, numop->position};
+            }
         }
         else if (const auto* varref = std::get_if<variable_reference>(&op))
         {
-            const auto const_it = _constants.find(varref->identifier);
-            if (const_it != _constants.end())
+            TC_STATS(bump(_counters->variables));
+            if (const number* constant = _constants.find(varref->identifier))
             {
-                stack.push_back(const_it->second);
+                TC_STATS(bump(_counters->constant_lookups));
+                stack.push_back(*constant);
                 continue;
             }
 
-            const auto var_it = _variables.find(varref->identifier);
-            if (var_it != _variables.end())
+            if (const number* variable = _variables.find(varref->identifier))
             {
-                stack.push_back(var_it->second);
+                TC_STATS(bump(_counters->variable_lookups));
+                stack.push_back(*variable);
                 continue;
             }
 
+            if (_snapshot != nullptr)
+            {
+                const number* restored = _snapshot_decoded.find(varref->identifier);
+                if (restored == nullptr)
+                    restored = decode_snapshot_variable(varref->identifier);
+                if (restored != nullptr)
+                {
+                    TC_STATS(bump(_counters->snapshot_lookups));
+                    stack.push_back(*restored);
+                    continue;
+                }
+            }
+
+            TC_STATS(bump(_counters->undefined_lookups));
             return eval_result<number>{eval_error_type::undefined_variable, varref->position};
         }
         else if (const auto* binop = std::get_if<binary_operator>(&op))
         {
+            TC_STATS(bump(_counters->binary[static_cast<size_t>(binop->operation)]));
             if (stack.size() < 2)
                 return eval_result<number>{eval_error_type::invalid_program, binop->position};
 
@@ -186,12 +462,14 @@ eval_result<number> evaluator::evaluate_arithmetic(const arithmetic_expression&
                 err = check_finite(stack.back(), _complex_mode);
                 if (err == eval_error_type::none)
                     continue;
+                TC_STATS(bump(_counters->finite_check_failures[static_cast<size_t>(err)]));
             }
 
             return eval_result<number>{err, binop->position};
         }
         else if (const auto* unop = std::get_if<unary_operator>(&op))
         {
+            TC_STATS(bump(_counters->unary[static_cast<size_t>(unop->operation)]));
             if (stack.empty())
                 return eval_result<number>{eval_error_type::invalid_program, unop->position};
 
@@ -202,38 +480,24 @@ eval_result<number> evaluator::evaluate_arithmetic(const arithmetic_expression&
                 err = check_finite(stack.back(), _complex_mode);
                 if (err == eval_error_type::none)
                     continue;
+                TC_STATS(bump(_counters->finite_check_failures[static_cast<size_t>(err)]));
             }
 
             return eval_result<number>{err, unop->position};
         }
         else if (const auto* fncall = std::get_if<function_call>(&op))
         {
+            TC_STATS(bump(_counters->calls));
             if (static_cast<fn_arity_t>(stack.size()) < fncall->arity)
                 return eval_result<number>{eval_error_type::invalid_program, fncall->position};
 
-            const auto native_it = _native_fns.find(fncall->identifier);
-
-            if (native_it == _native_fns.end())
-                return eval_result<number>{eval_error_type::undefined_function, fncall->position};
-
-            const auto& fns_with_this_name = native_it->second;
-
-            eval_error_type err = eval_error_type::bad_arity;
-
-            for (const auto& [arity, fn] : fns_with_this_name)
-            {
-                if (arity == fncall->arity)
-                {
-                    err = fn(stack, *this);
-                    break;
-                }
-            }
-
+            eval_error_type err = call_function(fncall, stack);
             if (err == eval_error_type::none)
             {
                 err = check_finite(stack.back(), _complex_mode);
                 if (err == eval_error_type::none)
                     continue;
+                TC_STATS(bump(_counters->finite_check_failures[static_cast<size_t>(err)]));
             }
 
             return eval_result<number>{err, fncall->position};
@@ -248,6 +512,7 @@ eval_result<number> evaluator::evaluate_arithmetic(const arithmetic_expression&
 
 eval_result<bool> evaluator::evaluate_boolean(const boolean_expression& expr) const
 {
+    TC_STATS(phase_scope phase{*_counters, evaluator_phase::boolean, false});
     const eval_result left = evaluate_arithmetic(expr.lhs);
     if (left.is_error())
         return eval_result<bool>{left.error()};
@@ -284,6 +549,7 @@ eval_result<bool> evaluator::evaluate_boolean(const boolean_expression& expr) co
 
 eval_result<assign_result> evaluator::evaluate_assignment(const assignment_expression& expr) const
 {
+    TC_STATS(phase_scope phase{*_counters, evaluator_phase::assignment, false});
     if (_constants.contains(expr.variable))
         return eval_result<assign_result>{eval_error_type::assign_to_constant, expr.position};
 
@@ -295,20 +561,59 @@ eval_result<assign_result> evaluator::evaluate_assignment(const assignment_expre
     return eval_result<assign_result>{{expr.variable, std::move(res.mut_value())}};
 }
 
+eval_error_type evaluator::call_function(const function_call* call, stack& stack) const
+{
+    TC_STATS(phase_scope phase{*_counters, evaluator_phase::function_call, false});
+    eval_error_type err = eval_error_type::undefined_function;
+
+    if (const auto* user_overloads = _user_fns.find(call->identifier))
+    {
+        for (const auto& [arity, fn] : *user_overloads)
+        {
+            if (arity == call->arity)
+            {
+                TC_STATS(bump(_counters->user_function_calls));
+                return fn(stack, *this);
+            }
+        }
+        err = eval_error_type::bad_arity;
+    }
+
+    if (const builtin_function* builtin = find_builtin(call->identifier))
+    {
+        for (const auto& [arity, fn] : builtin->overloads)
+        {
+            if (fn != nullptr && arity == call->arity)
+            {
+                TC_STATS(bump(_counters->builtin_calls[builtin - builtin_functions]));
+                const long precision = stack.empty() ? _precision : stack.back().precision();
+                trace_detail::span trace{builtin->name, "precision", precision};
+                return fn(stack, *this);
+            }
+        }
+        err = eval_error_type::bad_arity;
+    }
+
+    return err;
+}
+
 eval_error_type evaluator::evaluate_unary_operation(const unary_operator* op, stack& stack) const
 {
     switch (op->operation)
     {
         case token_kind::radical:
-            builtin_sqrt(stack, *this);
+            if (const auto err = builtin_sqrt(stack, *this); err != eval_error_type::none)
+                return err;
             break;
 
         case token_kind::cube_root:
-            builtin_cbrt(stack, *this);
+            if (const auto err = builtin_cbrt(stack, *this); err != eval_error_type::none)
+                return err;
             break;
 
         case token_kind::fourth_root:
-            builtin_fourth_root(stack, *this);
+            if (const auto err = builtin_fourth_root(stack, *this); err != eval_error_type::none)
+                return err;
             break;
 
         case token_kind::minus:
@@ -378,6 +683,8 @@ eval_error_type evaluator::evaluate_binary_operator(const binary_operator* op, s
         case token_kind::exponentiate:
             if (lhs == 0 && rhs == 0)
                 return eval_error_type::zero_pow_zero;
+            if (!_complex_mode && lhs.is_negative() && !rhs.is_integer())
+                return eval_error_type::real_mode_complex_result;
             lhs.pow(lhs, rhs);
             break;
 
@@ -2,12 +2,16 @@
 #define TC_EVALUATOR_H
 
 #include <functional>
-#include <map>
+#include <iosfwd>
+#include <memory>
+#include <vector>
 #include <string>
 
 #include "tc_eval_result.h"
+#include "tc_evaluator_stats.h"
 #include "tc_expression.h"
 #include "tc_number.h"
+#include "tc_symbol.h"
 
 namespace tcalc
 {
@@ -18,6 +22,8 @@ namespace tcalc
         gradians
     };
 
+    class snapshot_data;
+
     class evaluator final
     {
     public:
@@ -25,6 +31,8 @@ namespace tcalc
 
         using stack = std::vector<number>;
 
+        using native_fn_ptr = eval_error_type (*)(stack&, const evaluator&);
+
         struct native_fn
         {
             fn_arity_t arity;
@@ -33,6 +41,9 @@ namespace tcalc
 
         explicit evaluator(long precision);
 
+        // Name and arity of every builtin function overload.
+        static std::vector<std::pair<std::string_view, fn_arity_t>> builtin_signatures();
+
         [[nodiscard]]
         angle_unit trig_unit() const
         {
@@ -55,12 +66,60 @@ namespace tcalc
             _complex_mode = mode;
         }
 
+        [[nodiscard]]
+        bool arena_mode() const
+        {
+            return _arena_mode;
+        }
+
+        // When on and the allocator from tc_allocator.h is installed, each call to evaluate takes the memory for its
+        // temporaries from a per-thread bump arena, copies the result out and resets the arena when it returns. The
+        // arena also takes MPFR's cached constants, so they are recomputed by every evaluation that needs them.
+        void arena_mode(const bool mode)
+        {
+            _arena_mode = mode;
+        }
+
         [[nodiscard]]
         long precision() const
         {
             return _precision;
         }
 
+        // Adds a function to this evaluator only, replacing any builtin or other definition with that name and arity.
+        void define_function(std::string_view name, fn_arity_t arity,
+                             std::function<eval_error_type(stack&, const evaluator&)> fn);
+
+#ifdef TCALC_STATS
+        static constexpr bool stats_enabled = true;
+#else
+        static constexpr bool stats_enabled = false;
+#endif
+
+        // Counters of the work this evaluator has done since it was created or the counters were last taken. Empty
+        // unless the library is built with TCALC_STATS; copies of an evaluator count separately from zero.
+        [[nodiscard]]
+        evaluator_stats stats() const;
+
+        // Like stats, but also resets the counters, without losing work counted concurrently.
+        evaluator_stats take_stats();
+
+        // Writes the settings and every variable, including Ans, in a compact binary form. Functions are not saved.
+        void save(std::ostream& out) const;
+
+        // Replaces the precision, settings and variables with those written by save. Variables are decoded when they
+        // are first used and kept, so loading costs one pass over the names. Since evaluating fills that cache, an
+        // evaluator with a loaded snapshot must not evaluate on several threads at once; give each thread a copy.
+        // Returns false, leaving the evaluator unchanged, if the data is not a snapshot written on a machine with the
+        // same byte order and limb size, or if its precision is above 2^24 bits.
+        [[nodiscard]]
+        bool load(std::istream& in);
+
+        // Like load, but maps the file into memory instead of reading it; the mapping lives as long as any evaluator
+        // copied from this one still refers to it.
+        [[nodiscard]]
+        bool load_file(const std::string& path);
+
         [[nodiscard]]
         eval_result<result_type> evaluate(const expression& expr) const;
 
@@ -76,15 +135,26 @@ namespace tcalc
         eval_result<assign_result> evaluate_assignment(const assignment_expression& expr) const;
 
     private:
+        eval_result<result_type> evaluate_expression(const expression& expr) const;
         eval_error_type evaluate_unary_operation(const unary_operator* op, stack& stack) const;
         eval_error_type evaluate_binary_operator(const binary_operator* op, stack& stack) const;
+        eval_error_type call_function(const function_call* call, stack& stack) const;
+        bool load_snapshot(std::shared_ptr<const snapshot_data> snapshot);
+        const number* decode_snapshot_variable(symbol name) const;
+        evaluator_stats read_stats(bool reset) const;
 
         long _precision;
         bool _complex_mode = true;
         angle_unit _trig_unit = angle_unit::degrees;
-        std::map<std::string, number> _constants;
-        std::map<std::string, number> _variables;
-        std::map<std::string, std::vector<native_fn>> _native_fns;
+        bool _arena_mode = false;
+        symbol_table<number> _constants;
+        symbol_table<number> _variables;
+        std::shared_ptr<const snapshot_data> _snapshot; // Variables restored by load, shadowed by _variables
+        mutable symbol_table<number> _snapshot_decoded; // Variables of _snapshot decoded so far
+#ifdef TCALC_STATS
+        stats_detail::counters_ptr _counters;
+#endif
+        symbol_table<std::vector<native_fn>> _user_fns; // Overlay over the shared builtin table
     };
 }
 
@@ -0,0 +1,93 @@
+#ifndef TC_EVALUATOR_STATS_H
+#define TC_EVALUATOR_STATS_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace tcalc
+{
+    // Timed stages of evaluation. They nest: boolean and assignment include the arithmetic they evaluate, and
+    // arithmetic includes its function calls.
+    enum class evaluator_phase
+    {
+        arithmetic,
+        boolean,
+        assignment,
+        function_call,
+        commit,
+    };
+
+    std::string_view evaluator_phase_name(evaluator_phase phase);
+
+    // Work counted by an evaluator, when the library is built with TCALC_STATS. Named counters list only the names
+    // that were counted at least once.
+    struct evaluator_stats final
+    {
+        struct phase_time
+        {
+            std::string_view phase;
+            uint64_t calls;
+            double seconds;
+        };
+
+        // Operations executed, by opcode: "literal", "variable", "call", and "unary:<kind>" or "binary:<kind>" for
+        // operators, named after their token kind
+        std::vector<std::pair<std::string, uint64_t>> operations;
+        std::vector<std::pair<std::string_view, uint64_t>> builtin_calls;
+        std::vector<std::pair<std::string_view, uint64_t>> finite_check_failures; // By eval_error_type name
+        uint64_t user_function_calls = 0;
+
+        // Where variable references were resolved
+        uint64_t constant_lookups = 0;
+        uint64_t variable_lookups = 0;
+        uint64_t snapshot_lookups = 0;
+        uint64_t undefined_lookups = 0;
+
+        // Number work done while evaluating and committing, on the evaluating threads. Operations are calls of the
+        // arithmetic and transcendental members of number, each of which runs one or a few MPFR or MPC kernels.
+        uint64_t number_constructions = 0;
+        uint64_t number_copies = 0;
+        uint64_t number_operations = 0;
+        uint64_t number_pi_calls = 0; // Calls of mpfr_const_pi made by number itself, not from inside MPFR or MPC
+
+        std::vector<phase_time> phases;
+    };
+
+#ifdef TCALC_STATS
+    namespace stats_detail
+    {
+        struct evaluator_counters;
+
+        // Owns an evaluator's counters. A copied evaluator starts counting from zero.
+        class counters_ptr final
+        {
+        public:
+            counters_ptr();
+            counters_ptr(const counters_ptr&);
+            counters_ptr& operator=(const counters_ptr&);
+            counters_ptr(counters_ptr&&) noexcept;
+            counters_ptr& operator=(counters_ptr&&) noexcept;
+            ~counters_ptr();
+
+            evaluator_counters* operator->() const
+            {
+                return _counters.get();
+            }
+
+            evaluator_counters& operator*() const
+            {
+                return *_counters;
+            }
+
+        private:
+            std::unique_ptr<evaluator_counters> _counters;
+        };
+    }
+#endif
+}
+
+#endif // TC_EVALUATOR_STATS_H
@@ -14,11 +14,12 @@ namespace tcalc
     {
         std::vector<operation> tokens;
         source_position position;
+        size_t max_stack_depth = 0;
     };
 
     struct assignment_expression final
     {
-        std::string variable;
+        symbol variable;
         arithmetic_expression expression;
         source_position position;
     };
@@ -0,0 +1,145 @@
+#include "tc_incremental_parser.h"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+#include "tc_lexer.h"
+
+using namespace tcalc;
+
+namespace
+{
+    void shift(source_position& position, const std::ptrdiff_t delta)
+    {
+        position.start_index += delta;
+        position.end_index += delta;
+    }
+
+    void shift(arithmetic_expression& expr, const std::ptrdiff_t delta)
+    {
+        for (auto& op : expr.tokens)
+            std::visit([delta](auto& o) { shift(o.position, delta); }, op);
+        shift(expr.position, delta);
+    }
+
+    void shift(expression& expr, const std::ptrdiff_t delta)
+    {
+        if (auto* arith = std::get_if<arithmetic_expression>(&expr))
+        {
+            shift(*arith, delta);
+        }
+        else if (auto* asgn = std::get_if<assignment_expression>(&expr))
+        {
+            shift(asgn->expression, delta);
+            shift(asgn->position, delta);
+        }
+        else if (auto* boolean = std::get_if<boolean_expression>(&expr))
+        {
+            shift(boolean->lhs, delta);
+            shift(boolean->rhs, delta);
+            shift(boolean->position, delta);
+        }
+    }
+
+    diagnostic shifted(const diagnostic& diag, const std::ptrdiff_t delta)
+    {
+        source_position position = diag.position();
+        shift(position, delta);
+        return diagnostic{position, diag.type(), std::vector<std::string>{diag.arguments()}};
+    }
+}
+
+incremental_parser::incremental_parser(std::string text, const bool comma_arg_separator, const long number_precision) :
+    _text{std::move(text)},
+    _parser{lexer::borrowing({}, comma_arg_separator), number_precision}
+{
+    reparse(0, _text.size() + 1, 0);
+}
+
+size_t incremental_parser::edit(const size_t start_index, const size_t end_index, const std::string_view replacement)
+{
+    if (start_index > end_index || end_index > _text.size())
+        throw std::out_of_range{"edit range"};
+
+    _text.replace(start_index, end_index - start_index, replacement);
+    const auto delta = static_cast<std::ptrdiff_t>(replacement.size())
+        - static_cast<std::ptrdiff_t>(end_index - start_index);
+
+    // The first segment whose parse looked at an edited byte. Looking at the end of the text counts as looking one byte
+    // past it, so that appending reparses the last segment.
+    const auto first = std::ranges::upper_bound(_segments, start_index, {}, &segment::read_extent);
+    return reparse(static_cast<size_t>(first - _segments.begin()), end_index, delta);
+}
+
+size_t incremental_parser::reparse(const size_t first_index, const size_t reuse_from, const std::ptrdiff_t delta)
+{
+    const size_t start = first_index == 0 ? 0 : _segments[first_index].start_index;
+    _parser.reset(_text, start);
+
+    // The first token was lexed by the segment before, which already holds anything reported for it.
+    size_t reported = first_index == 0 ? 0 : _parser.diagnostic_bag().size();
+
+    std::vector<segment> fresh;
+    auto reusable = std::ranges::lower_bound(_segments, reuse_from, {}, &segment::start_index);
+
+    while (true)
+    {
+        segment seg{_parser.next_start_index(), 0, {}, {}};
+        _parser.parse_expression(seg.expr);
+        seg.read_extent = _parser.read_extent();
+
+        const auto& bag = _parser.diagnostic_bag();
+        seg.diagnostics.assign(bag.begin() + static_cast<std::ptrdiff_t>(reported), bag.end());
+        reported = bag.size();
+        fresh.push_back(std::move(seg));
+
+        if (_parser.at_end())
+        {
+            reusable = _segments.end();
+            break;
+        }
+
+        // From a token start that an unedited segment also started at, the rest of the parse would be the same.
+        const size_t next = _parser.next_start_index();
+        while (reusable != _segments.end() && static_cast<std::ptrdiff_t>(reusable->start_index) + delta <
+               static_cast<std::ptrdiff_t>(next))
+            ++reusable;
+        if (reusable != _segments.end() && static_cast<std::ptrdiff_t>(reusable->start_index) + delta ==
+            static_cast<std::ptrdiff_t>(next))
+            break;
+    }
+
+    const size_t reparsed = fresh.size();
+
+    for (auto it = reusable; it != _segments.end(); ++it)
+    {
+        it->start_index += delta;
+        it->read_extent += delta;
+        shift(it->expr, delta);
+        for (auto& diag : it->diagnostics)
+            diag = shifted(diag, delta);
+        fresh.push_back(std::move(*it));
+    }
+
+    _segments.erase(_segments.begin() + static_cast<std::ptrdiff_t>(first_index), _segments.end());
+    std::ranges::move(fresh, std::back_inserter(_segments));
+    return reparsed;
+}
+
+std::vector<expression> incremental_parser::expressions() const
+{
+    std::vector<expression> exprs;
+    exprs.reserve(_segments.size());
+    for (const auto& seg : _segments)
+        exprs.push_back(seg.expr);
+    return exprs;
+}
+
+std::vector<diagnostic> incremental_parser::diagnostics() const
+{
+    std::vector<diagnostic> diags;
+    for (const auto& seg : _segments)
+        diags.insert(diags.end(), seg.diagnostics.begin(), seg.diagnostics.end());
+    return diags;
+}
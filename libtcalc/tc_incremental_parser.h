@@ -0,0 +1,68 @@
+#ifndef TC_INCREMENTAL_PARSER_H
+#define TC_INCREMENTAL_PARSER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "tc_diagnostic.h"
+#include "tc_expression.h"
+#include "tc_parser.h"
+
+namespace tcalc
+{
+    // Keeps a whole document parsed across edits. An edit relexes and reparses only the expressions whose input it
+    // touched, and shifts the positions of those after it; the result always matches a full parse_all of the new text.
+    class incremental_parser final
+    {
+    public:
+        incremental_parser(std::string text, bool comma_arg_separator, long number_precision);
+
+        // Replaces the bytes in [start_index, end_index) with the replacement. Returns how many expressions had to be
+        // reparsed.
+        size_t edit(size_t start_index, size_t end_index, std::string_view replacement);
+
+        [[nodiscard]]
+        const std::string& text() const
+        {
+            return _text;
+        }
+
+        [[nodiscard]]
+        size_t expression_count() const
+        {
+            return _segments.size();
+        }
+
+        [[nodiscard]]
+        const expression& expression_at(const size_t index) const
+        {
+            return _segments[index].expr;
+        }
+
+        [[nodiscard]]
+        std::vector<expression> expressions() const;
+
+        [[nodiscard]]
+        std::vector<diagnostic> diagnostics() const;
+
+    private:
+        struct segment
+        {
+            size_t start_index; // Where its first token starts
+            size_t read_extent; // One past the last byte its parse looked at
+            expression expr;
+            std::vector<diagnostic> diagnostics; // Reported while parsing it, in order
+        };
+
+        // Parses from the segment at first_index to the end of the text, stopping early once an expression starts where
+        // one of the reusable segments does. Reusable segments start at or after reuse_from and are shifted by delta.
+        size_t reparse(size_t first_index, size_t reuse_from, std::ptrdiff_t delta);
+
+        std::string _text;
+        parser _parser;
+        std::vector<segment> _segments;
+    };
+}
+
+#endif // TC_INCREMENTAL_PARSER_H
@@ -1,30 +1,66 @@
 #include "tc_lexer.h"
 
+#include <array>
 #include <unordered_map>
 #include <optional>
 
+#include "internal/trace.h"
 #include "internal/utf8utils.h"
 
 using namespace tcalc;
 
 namespace
 {
-    bool is_whitespace(const std::optional<char32_t> chr)
+    enum char_class : uint8_t
     {
-        if (!chr.has_value())
-            return false;
+        whitespace = 1 << 0,
+        letter = 1 << 1
+    };
+
+    uint8_t classify(const char32_t chr)
+    {
+        uint8_t classes = 0;
+        const auto c = utf8utils::category(chr);
         // tab is not in category ZS. conveniently, neither is LF.
-        return chr == U'\t' || utf8utils::category(*chr) == UTF8PROC_CATEGORY_ZS;
+        if (chr == U'\t' || c == UTF8PROC_CATEGORY_ZS)
+            classes |= whitespace;
+        if ((c >= UTF8PROC_CATEGORY_LU && c <= UTF8PROC_CATEGORY_LO) || c == UTF8PROC_CATEGORY_PC
+            || c == UTF8PROC_CATEGORY_NO)
+            classes |= letter;
+        return classes;
     }
 
-    bool is_letter(const std::optional<char32_t> chr)
+    // Nearly all input is ASCII or Latin-1, so the classes of the first 256 code points are looked up once instead of
+    // asking utf8proc for every character. Built on first use, so that lexing works during static initialization.
+    const std::array<uint8_t, 256>& latin1_classes()
+    {
+        static const std::array<uint8_t, 256> table = []
+        {
+            std::array<uint8_t, 256> classes{};
+            for (char32_t chr = 0; chr < classes.size(); chr++)
+                classes[chr] = classify(chr);
+            return classes;
+        }();
+        return table;
+    }
+
+    bool has_class(const std::optional<char32_t> chr, const char_class cls)
     {
         if (!chr.has_value())
             return false;
-        const auto c = utf8utils::category(*chr);
-        return (c >= UTF8PROC_CATEGORY_LU && c <= UTF8PROC_CATEGORY_LO)
-            || c == UTF8PROC_CATEGORY_PC
-            || c == UTF8PROC_CATEGORY_NO;
+        if (*chr < 256)
+            return latin1_classes()[*chr] & cls;
+        return classify(*chr) & cls;
+    }
+
+    bool is_whitespace(const std::optional<char32_t> chr)
+    {
+        return has_class(chr, whitespace);
+    }
+
+    bool is_letter(const std::optional<char32_t> chr)
+    {
+        return has_class(chr, letter);
     }
 
     bool is_decimal_digit(const std::optional<char32_t> chr)
@@ -81,12 +117,13 @@ namespace
     template<bool Superscript>
     bool start_reading_exponent(string_reader& sr)
     {
-        const auto next3 = sr.peek_many(3);
-        if (next3.length() >= 2) // Otherwise we don't have enough input to keep going
+        std::array<char32_t, 3> next3{};
+        const auto length = sr.peek_many(next3);
+        if (length >= 2) // Otherwise we don't have enough input to keep going
         {
             if (next3[1] == plus(Superscript) || next3[1] == minus(Superscript))
             {
-                if (next3.length() == 3 && is_digit<Superscript>(next3[2])) // If it was a +/-, we need to consume a digit
+                if (length == 3 && is_digit<Superscript>(next3[2])) // If it was a +/-, we need to consume a digit
                 {
                     sr.forward_many(3);
                     return true;
@@ -104,6 +141,8 @@ namespace
 
 token lexer::next()
 {
+    trace_detail::lex_span trace;
+
     while (is_whitespace(_sr.peek()))
         _sr.forward();
 
@@ -136,7 +175,7 @@ token lexer::next()
 token lexer::flush_token(const token_kind kind)
 {
     const auto [pos, str_view] = _sr.flush();
-    return {kind, std::string{str_view}, pos};
+    return {kind, str_view, pos};
 }
 
 token lexer::lex_binary_number()
@@ -167,7 +206,7 @@ token lexer::lex_decimal_number()
 
         if (is_decimal_digit(next) || next == U'\'')
         {
-            _sr.forward();
+            _sr.forward_digit_run();
         }
         else if (next == decimal_separator())
         {
@@ -375,7 +414,7 @@ token lexer::lex_word()
 
     const auto type_iter = keywords.find(str_view);
     if (type_iter != keywords.end())
-        return {type_iter->second, std::string{str_view}, pos};
+        return {type_iter->second, str_view, pos};
 
-    return {token_kind::identifier, std::string{str_view}, pos};
+    return {token_kind::identifier, str_view, pos};
 }
@@ -26,14 +26,41 @@ namespace tcalc
         {
         }
 
+        // Lexes the input in place without copying it; the caller must keep it alive for as long as the lexer and its
+        // tokens.
+        static lexer borrowing(const std::string_view input, const bool comma_arg_separator)
+        {
+            return lexer{string_reader::borrowing(input), comma_arg_separator};
+        }
+
+        // Starts lexing a new borrowed input from the given byte index, keeping the diagnostic bag's capacity.
+        void reset(const std::string_view input, const size_t start_index = 0)
+        {
+            _sr.reset(input, start_index);
+            _diagnostic_bag.clear();
+            _reached_end = false;
+        }
+
         [[nodiscard]]
         std::vector<diagnostic>& diagnostic_bag()
         {
             return _diagnostic_bag;
         }
 
+        [[nodiscard]]
+        const std::vector<diagnostic>& diagnostic_bag() const
+        {
+            return _diagnostic_bag;
+        }
+
         token next();
 
+        [[nodiscard]]
+        size_t read_extent() const
+        {
+            return _sr.read_extent();
+        }
+
         [[nodiscard]]
         bool reached_end() const
         {
@@ -41,6 +68,12 @@ namespace tcalc
         }
 
     private:
+        lexer(string_reader&& sr, const bool comma_arg_separator) :
+            _sr{std::move(sr)},
+            _comma_argument_separator{comma_arg_separator}
+        {
+        }
+
         token flush_token(token_kind);
         token lex_hex_number();
         token lex_decimal_number();
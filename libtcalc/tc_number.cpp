@@ -1,8 +1,13 @@
 #include "tc_number.h"
 
+#include <algorithm>
 #include <cassert>
+#include <climits>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
+#include <vector>
 
 #ifdef _MSC_VER
 #pragma warning(push, 0) // mpc header has warnings on MSVC /W4
@@ -15,6 +20,10 @@
 #pragma warning(pop)
 #endif
 
+#include "internal/allocator.h"
+#include "internal/stats.h"
+#include "internal/trace.h"
+
 using namespace tcalc;
 
 struct memory_stuff final
@@ -53,6 +62,12 @@ struct tcalc::number_pimpl final
         return mpc_imagref(ref);
     }
 
+    [[nodiscard]]
+    bool is_real() const
+    {
+        return mpfr_zero_p(imag_ref());
+    }
+
     static memory_stuff memory_stuff_inst;
 };
 
@@ -61,6 +76,91 @@ memory_stuff number_pimpl::memory_stuff_inst{};
 static constexpr mpc_rnd_t round_mode = MPC_RNDNN;
 static constexpr mpfr_rnd_t fr_round_mode = MPFR_RNDN;
 
+using mpfr_unary_fn = int (*)(mpfr_ptr, mpfr_srcptr, mpfr_rnd_t);
+using mpc_unary_fn = int (*)(mpc_ptr, mpc_srcptr, mpc_rnd_t);
+using mpfr_binary_fn = int (*)(mpfr_ptr, mpfr_srcptr, mpfr_srcptr, mpfr_rnd_t);
+using mpc_binary_fn = int (*)(mpc_ptr, mpc_srcptr, mpc_srcptr, mpc_rnd_t);
+
+// Every use of pi goes through here, so that TCALC_STATS can count them; MPFR caches the value, but recomputes it
+// whenever a higher precision is asked for.
+static void const_pi(mpfr_ptr out)
+{
+    TC_STATS(stats_detail::number_counts.pi_calls++);
+    mpfr_const_pi(out, fr_round_mode);
+}
+
+// When the caller knows the result of a real argument stays real, run the MPFR kernel on the real part only and skip
+// the MPC work on the (zero) imaginary half.
+static void apply_unary(number_pimpl& out, const number_pimpl& x, const bool real_result, const mpfr_unary_fn fr_fn,
+                        const mpc_unary_fn c_fn)
+{
+    if (real_result)
+    {
+        fr_fn(out.real_ref(), x.real_ref(), fr_round_mode);
+        mpfr_set_zero(out.imag_ref(), 1);
+    }
+    else
+    {
+        c_fn(out.ref, x.ref, round_mode);
+    }
+}
+
+static void apply_binary(number_pimpl& out, const number_pimpl& lhs, const number_pimpl& rhs, const bool real_result,
+                         const mpfr_binary_fn fr_fn, const mpc_binary_fn c_fn)
+{
+    if (real_result)
+    {
+        fr_fn(out.real_ref(), lhs.real_ref(), rhs.real_ref(), fr_round_mode);
+        mpfr_set_zero(out.imag_ref(), 1);
+    }
+    else
+    {
+        c_fn(out.ref, lhs.ref, rhs.ref, round_mode);
+    }
+}
+
+static constexpr long quarter_turn_sines[] = {0, 1, 0, -1};
+
+// If x is a real multiple of pi/2, returns how many quarter turns it spans modulo 4, otherwise -1. This lets the
+// trigonometric kernels return exact zeros and ones where the rounded pi would leave a tiny residue. Once x is too
+// large to carry any fractional quarter turn at its precision, the test is meaningless and is skipped.
+static int exact_quarter_turns(const number_pimpl& x)
+{
+    if (!x.is_real())
+        return -1;
+
+    const mpfr_prec_t prec = mpfr_get_prec(x.real_ref());
+    mpfr_t quarters;
+    mpfr_init2(quarters, prec);
+    const_pi(quarters);
+    mpfr_div(quarters, x.real_ref(), quarters, fr_round_mode);
+    mpfr_mul_2ui(quarters, quarters, 1, fr_round_mode);
+
+    int turns = -1;
+    if (mpfr_zero_p(quarters))
+    {
+        turns = 0;
+    }
+    else if (mpfr_integer_p(quarters) && mpfr_get_exp(quarters) < prec)
+    {
+        mpfr_fmod_ui(quarters, quarters, 4, fr_round_mode); // Exact, as quarters is an integer
+        turns = static_cast<int>((mpfr_get_si(quarters, fr_round_mode) + 4) % 4);
+    }
+
+    mpfr_clear(quarters);
+    return turns;
+}
+
+static bool real_at_least(const number_pimpl& x, const long min)
+{
+    return x.is_real() && mpfr_cmp_si(x.real_ref(), min) >= 0;
+}
+
+static bool real_in_unit_interval(const number_pimpl& x)
+{
+    return x.is_real() && mpfr_cmp_si(x.real_ref(), -1) >= 0 && mpfr_cmp_si(x.real_ref(), 1) <= 0;
+}
+
 static std::string make_mpfr_format(const std::string_view from)
 {
     std::string str{};
@@ -81,6 +181,8 @@ static std::string make_mpfr_format(const std::string_view from)
 
 number::number(const long precision) : d{std::make_unique<number_pimpl>()}
 {
+    allocator_detail::note_number_created();
+    TC_STATS(stats_detail::number_counts.constructions++);
     mpc_init2(d->ref, precision);
     set(0, 0);
 }
@@ -92,9 +194,20 @@ number::number(const number& other)
 
 number& number::operator=(const number& other)
 {
+    TC_STATS(stats_detail::number_counts.copies++);
+    if (this == &other)
+        return *this;
+
     const auto prec = other.precision();
-    d = std::make_unique<number_pimpl>();
-    mpc_init2(d->ref, prec);
+    if (d == nullptr)
+    {
+        d = std::make_unique<number_pimpl>();
+        mpc_init2(d->ref, prec);
+    }
+    else
+    {
+        mpc_set_prec(d->ref, prec); // Reuses the limbs, instead of leaking them with the old pimpl
+    }
     mpc_set(d->ref, other.d->ref, round_mode);
     return *this;
 }
@@ -106,6 +219,8 @@ number::number(number&& other) noexcept
 
 number& number::operator=(number&& other) noexcept
 {
+    if (d != nullptr && this != &other)
+        mpc_clear(d->ref);
     d = std::move(other.d);
     return *this;
 }
@@ -157,9 +272,35 @@ void number::set_hexadecimal(const std::string_view hex)
     mpfr_set_str(d->real_ref(), &string.c_str()[2], 16, fr_round_mode); // Cut 0x part off
 }
 
+void number::set_double(const double x)
+{
+    mpc_set_d(d->ref, x, round_mode);
+}
+
+void number::set_long_double(const long double x)
+{
+    mpc_set_ld(d->ref, x, round_mode);
+}
+
+double number::real_double() const
+{
+    return mpfr_get_d(d->real_ref(), fr_round_mode);
+}
+
+long double number::real_long_double() const
+{
+    return mpfr_get_ld(d->real_ref(), fr_round_mode);
+}
+
+long number::real_exponent() const
+{
+    assert(mpfr_regular_p(d->real_ref()));
+    return mpfr_get_exp(d->real_ref());
+}
+
 bool number::is_real() const
 {
-    return mpfr_zero_p(d->imag_ref());
+    return d->is_real();
 }
 
 bool number::is_infinity() const
@@ -190,6 +331,16 @@ bool number::operator==(const long r) const
     return mpc_cmp_si_si(d->ref, r, 0) == 0;
 }
 
+bool number::operator<(const long r) const
+{
+    return mpfr_cmp_si(d->real_ref(), r) < 0;
+}
+
+bool number::operator>(const long r) const
+{
+    return mpfr_cmp_si(d->real_ref(), r) > 0;
+}
+
 bool number::operator<(const number& b) const
 {
     const int res = mpc_cmp(d->ref, b.d->ref);
@@ -214,63 +365,116 @@ long number::precision() const
 
 void number::add(const number& lhs, const number& rhs)
 {
-    mpc_add(d->ref, lhs.d->ref, rhs.d->ref, round_mode);
+    TC_STATS(stats_detail::number_counts.operations++);
+    apply_binary(*d, *lhs.d, *rhs.d, lhs.is_real() && rhs.is_real(), mpfr_add, mpc_add);
 }
 
 void number::sub(const number& lhs, const number& rhs)
 {
-    mpc_sub(d->ref, lhs.d->ref, rhs.d->ref, round_mode);
+    TC_STATS(stats_detail::number_counts.operations++);
+    apply_binary(*d, *lhs.d, *rhs.d, lhs.is_real() && rhs.is_real(), mpfr_sub, mpc_sub);
 }
 
 void number::negate(const number& x)
 {
-    if (*this != 0)
+    TC_STATS(stats_detail::number_counts.operations++);
+    if (*this == 0)
+        return;
+    if (x.is_real())
+    {
+        mpfr_neg(d->real_ref(), x.d->real_ref(), fr_round_mode);
+        set_imaginary(0);
+    }
+    else
+    {
         mpc_mul_si(d->ref, x.d->ref, -1, round_mode);
+    }
 }
 
 void number::mul(const number& lhs, const number& rhs)
 {
-    mpc_mul(d->ref, lhs.d->ref, rhs.d->ref, round_mode);
+    TC_STATS(stats_detail::number_counts.operations++);
+    apply_binary(*d, *lhs.d, *rhs.d, lhs.is_real() && rhs.is_real(), mpfr_mul, mpc_mul);
 }
 
 void number::mul(const number& lhs, const long rhs)
 {
-    mpc_mul_si(d->ref, lhs.d->ref, rhs, round_mode);
+    TC_STATS(stats_detail::number_counts.operations++);
+    if (lhs.is_real())
+    {
+        mpfr_mul_si(d->real_ref(), lhs.d->real_ref(), rhs, fr_round_mode);
+        set_imaginary(0);
+    }
+    else
+    {
+        mpc_mul_si(d->ref, lhs.d->ref, rhs, round_mode);
+    }
+}
+
+void number::mul_2exp(const number& x, const long exponent)
+{
+    TC_STATS(stats_detail::number_counts.operations++);
+    mpc_mul_2si(d->ref, x.d->ref, exponent, round_mode);
 }
 
 void number::div(const number& lhs, const number& rhs)
 {
-    mpc_div(d->ref, lhs.d->ref, rhs.d->ref, round_mode);
+    TC_STATS(stats_detail::number_counts.operations++);
+    apply_binary(*d, *lhs.d, *rhs.d, lhs.is_real() && rhs.is_real(), mpfr_div, mpc_div);
 }
 
 void number::div(const number &lhs, unsigned long rhs)
 {
-    mpc_div_ui(d->ref, lhs.d->ref, rhs, round_mode);
+    TC_STATS(stats_detail::number_counts.operations++);
+    if (lhs.is_real())
+    {
+        mpfr_div_ui(d->real_ref(), lhs.d->real_ref(), rhs, fr_round_mode);
+        set_imaginary(0);
+    }
+    else
+    {
+        mpc_div_ui(d->ref, lhs.d->ref, rhs, round_mode);
+    }
 }
 
 void number::pow(const number& lhs, const number& rhs)
 {
-    mpc_pow(d->ref, lhs.d->ref, rhs.d->ref, round_mode);
+    TC_STATS(stats_detail::number_counts.operations++);
+    // A negative base only stays real for integer exponents
+    const bool real_result = lhs.is_real() && rhs.is_real() && (!lhs.is_negative() || rhs.is_integer());
+    apply_binary(*d, *lhs.d, *rhs.d, real_result, mpfr_pow, mpc_pow);
 }
 
 void number::sqrt(const number& x)
 {
-    mpc_sqrt(d->ref, x.d->ref, round_mode);
+    TC_STATS(stats_detail::number_counts.operations++);
+    apply_unary(*d, *x.d, real_at_least(*x.d, 0), mpfr_sqrt, mpc_sqrt);
 }
 
 void number::reciprocal(const number& x)
 {
-    mpc_pow_si(d->ref, x.d->ref, -1, round_mode);
+    TC_STATS(stats_detail::number_counts.operations++);
+    if (x.is_real())
+    {
+        mpfr_ui_div(d->real_ref(), 1, x.d->real_ref(), fr_round_mode);
+        set_imaginary(0);
+    }
+    else
+    {
+        mpc_pow_si(d->ref, x.d->ref, -1, round_mode);
+    }
 }
 
 void number::reciprocal(const long x)
 {
+    TC_STATS(stats_detail::number_counts.operations++);
     set(x);
     reciprocal(*this);
 }
 
 void number::nth_root(const number& x, const number& root)
 {
+    TC_STATS(stats_detail::number_counts.operations++);
     if (x.is_real() && !x.is_negative() && root.is_integer() && !root.is_negative())
     {
         long si_root = mpfr_get_si(root.d->real_ref(), fr_round_mode);
@@ -287,6 +491,7 @@ void number::nth_root(const number& x, const number& root)
 
 void number::nth_root(const number& x, const long root)
 {
+    TC_STATS(stats_detail::number_counts.operations++);
     number r{precision()};
     r.set(root);
     nth_root(x, r);
@@ -294,125 +499,203 @@ void number::nth_root(const number& x, const long root)
 
 void number::exp(const number& x)
 {
-    mpc_exp(d->ref, x.d->ref, round_mode);
+    TC_STATS(stats_detail::number_counts.operations++);
+    apply_unary(*d, *x.d, x.is_real(), mpfr_exp, mpc_exp);
 }
 
 void number::log(const number& x)
 {
-    mpc_log10(d->ref, x.d->ref, round_mode);
+    TC_STATS(stats_detail::number_counts.operations++);
+    apply_unary(*d, *x.d, real_at_least(*x.d, 0), mpfr_log10, mpc_log10);
 }
 
 void number::ln(const number& x)
 {
-    mpc_log(d->ref, x.d->ref, round_mode);
+    TC_STATS(stats_detail::number_counts.operations++);
+    apply_unary(*d, *x.d, real_at_least(*x.d, 0), mpfr_log, mpc_log);
 }
 
 void number::sin(const number& x)
 {
-    const number pi = number::pi(x.precision());
-    number k{x.precision()};
-    k.div(x, pi);
-    if (k.is_integer())
-        set(0);
+    TC_STATS(stats_detail::number_counts.operations++);
+    if (const int turns = exact_quarter_turns(*x.d); turns >= 0)
+        set(quarter_turn_sines[turns]);
     else
-        mpc_sin(d->ref, x.d->ref, round_mode);
+        apply_unary(*d, *x.d, x.is_real(), mpfr_sin, mpc_sin);
 }
 
 void number::cos(const number& x)
 {
-    const number pi = number::pi(x.precision());
-    number k{x.precision()};
-    k.div(x, pi);
-    mpfr_sub_d(k.d->real_ref(), k.d->real_ref(), 0.5, fr_round_mode);
-    if (k.is_integer())
-        set(0);
+    TC_STATS(stats_detail::number_counts.operations++);
+    if (const int turns = exact_quarter_turns(*x.d); turns >= 0)
+        set(quarter_turn_sines[(turns + 1) % 4]);
     else
-        mpc_cos(d->ref, x.d->ref, round_mode);
+        apply_unary(*d, *x.d, x.is_real(), mpfr_cos, mpc_cos);
 }
 
 void number::tan(const number& x)
 {
-    const number pi = number::pi(x.precision());
-    number k{x.precision()};
-    k.div(x, pi);
-    if (k.is_integer())
+    TC_STATS(stats_detail::number_counts.operations++);
+    if (const int turns = exact_quarter_turns(*x.d); turns >= 0 && turns % 2 == 0)
         set(0);
     else
-        mpc_tan(d->ref, x.d->ref, round_mode);
+        apply_unary(*d, *x.d, x.is_real(), mpfr_tan, mpc_tan);
+}
+
+void number::sin_cos(number& cos_out, const number& x)
+{
+    TC_STATS(stats_detail::number_counts.operations++);
+    assert(&cos_out != this && &cos_out != &x);
+
+    if (const int turns = exact_quarter_turns(*x.d); turns >= 0)
+    {
+        set(quarter_turn_sines[turns]);
+        cos_out.set(quarter_turn_sines[(turns + 1) % 4]);
+    }
+    else if (x.is_real())
+    {
+        mpfr_sin_cos(d->real_ref(), cos_out.d->real_ref(), x.d->real_ref(), fr_round_mode);
+        set_imaginary(0);
+        cos_out.set_imaginary(0);
+    }
+    else
+    {
+        mpc_sin_cos(d->ref, cos_out.d->ref, x.d->ref, round_mode, round_mode);
+    }
 }
 
 void number::abs(const number& x)
 {
+    TC_STATS(stats_detail::number_counts.operations++);
     mpc_abs(d->real_ref(), x.d->ref, fr_round_mode);
     set_imaginary(0);
 }
 
 void number::re(const number& x)
 {
+    TC_STATS(stats_detail::number_counts.operations++);
     mpc_real(d->real_ref(), x.d->ref, fr_round_mode);
     set_imaginary(0);
 }
 
 void number::im(const number& x)
 {
+    TC_STATS(stats_detail::number_counts.operations++);
     mpc_imag(d->real_ref(), x.d->ref, fr_round_mode);
     set_imaginary(0);
 }
 
 void number::arg(const number& x)
 {
+    TC_STATS(stats_detail::number_counts.operations++);
     mpc_arg(d->real_ref(), x.d->ref, fr_round_mode);
     set_imaginary(0);
 }
 
 void number::conj(const number& x)
 {
+    TC_STATS(stats_detail::number_counts.operations++);
     mpc_conj(d->ref, x.d->ref, round_mode);
 }
 
 void tcalc::number::asin(const number& x)
 {
-    mpc_asin(d->ref, x.d->ref, round_mode);
+    apply_unary(*d, *x.d, real_in_unit_interval(*x.d), mpfr_asin, mpc_asin);
 }
 
 void tcalc::number::acos(const number& x)
 {
-    mpc_acos(d->ref, x.d->ref, round_mode);
+    apply_unary(*d, *x.d, real_in_unit_interval(*x.d), mpfr_acos, mpc_acos);
 }
 
 void tcalc::number::atan(const number& x)
 {
-    mpc_atan(d->ref, x.d->ref, round_mode);
+    apply_unary(*d, *x.d, x.is_real(), mpfr_atan, mpc_atan);
 }
 
 void number::sinh(const number& x)
 {
-    mpc_sinh(d->ref, x.d->ref, round_mode);
+    TC_STATS(stats_detail::number_counts.operations++);
+    apply_unary(*d, *x.d, x.is_real(), mpfr_sinh, mpc_sinh);
 }
 
 void number::cosh(const number& x)
 {
-    mpc_cosh(d->ref, x.d->ref, round_mode);
+    TC_STATS(stats_detail::number_counts.operations++);
+    apply_unary(*d, *x.d, x.is_real(), mpfr_cosh, mpc_cosh);
 }
 
 void number::tanh(const number& x)
 {
-    mpc_tanh(d->ref, x.d->ref, round_mode);
+    TC_STATS(stats_detail::number_counts.operations++);
+    apply_unary(*d, *x.d, x.is_real(), mpfr_tanh, mpc_tanh);
 }
 
 void number::asinh(const number& x)
 {
-    mpc_asinh(d->ref, x.d->ref, round_mode);
+    TC_STATS(stats_detail::number_counts.operations++);
+    apply_unary(*d, *x.d, x.is_real(), mpfr_asinh, mpc_asinh);
 }
 
 void number::acosh(const number& x)
 {
-    mpc_acosh(d->ref, x.d->ref, round_mode);
+    TC_STATS(stats_detail::number_counts.operations++);
+    apply_unary(*d, *x.d, real_at_least(*x.d, 1), mpfr_acosh, mpc_acosh);
 }
 
 void number::atanh(const number& x)
 {
-    mpc_atanh(d->ref, x.d->ref, round_mode);
+    TC_STATS(stats_detail::number_counts.operations++);
+    apply_unary(*d, *x.d, real_in_unit_interval(*x.d), mpfr_atanh, mpc_atanh);
+}
+
+void number::sin(const number& x, const unsigned long turn)
+{
+    TC_STATS(stats_detail::number_counts.operations++);
+    mpfr_sinu(d->real_ref(), x.d->real_ref(), turn, fr_round_mode);
+    set_imaginary(0);
+}
+
+void number::cos(const number& x, const unsigned long turn)
+{
+    TC_STATS(stats_detail::number_counts.operations++);
+    mpfr_cosu(d->real_ref(), x.d->real_ref(), turn, fr_round_mode);
+    set_imaginary(0);
+}
+
+void number::tan(const number& x, const unsigned long turn)
+{
+    TC_STATS(stats_detail::number_counts.operations++);
+    mpfr_tanu(d->real_ref(), x.d->real_ref(), turn, fr_round_mode);
+    set_imaginary(0);
+}
+
+void number::asin(const number& x, const unsigned long turn)
+{
+    TC_STATS(stats_detail::number_counts.operations++);
+    mpfr_asinu(d->real_ref(), x.d->real_ref(), turn, fr_round_mode);
+    set_imaginary(0);
+}
+
+void number::acos(const number& x, const unsigned long turn)
+{
+    TC_STATS(stats_detail::number_counts.operations++);
+    mpfr_acosu(d->real_ref(), x.d->real_ref(), turn, fr_round_mode);
+    set_imaginary(0);
+}
+
+void number::atan(const number& x, const unsigned long turn)
+{
+    TC_STATS(stats_detail::number_counts.operations++);
+    mpfr_atanu(d->real_ref(), x.d->real_ref(), turn, fr_round_mode);
+    set_imaginary(0);
+}
+
+void number::arg(const number& x, const unsigned long turn)
+{
+    TC_STATS(stats_detail::number_counts.operations++);
+    mpfr_atan2u(d->real_ref(), x.d->imag_ref(), x.d->real_ref(), turn, fr_round_mode);
+    set_imaginary(0);
 }
 
 static std::string make_string(mpfr_srcptr op, int digits, char format)
@@ -431,6 +714,7 @@ std::string number::string() const
 
 std::string number::string(int digits, const number_format format) const
 {
+    trace_detail::span trace{"number::string", "precision", precision()};
     char format_ch;
     switch (format)
     {
@@ -503,10 +787,134 @@ std::string number::dbg_string() const
     return str;
 }
 
+namespace
+{
+    // Layout of each part of a number's binary image. The significand limbs follow, zero padded to a multiple of 8
+    // bytes so that every header and significand in a snapshot stays aligned.
+    struct binary_part_header
+    {
+        int64_t precision;
+        int32_t kind; // mpfr_custom_get_kind, negative for negative numbers
+        int32_t reserved;
+        int64_t exponent; // Only meaningful for regular numbers
+    };
+
+    static_assert(sizeof(binary_part_header) % 8 == 0);
+
+    size_t padded_significand_size(const mpfr_prec_t prec)
+    {
+        return (mpfr_custom_get_size(prec) + 7) & ~size_t{7};
+    }
+
+    size_t significand_limbs(const mpfr_prec_t prec)
+    {
+        return static_cast<size_t>((prec + GMP_NUMB_BITS - 1) / GMP_NUMB_BITS);
+    }
+
+    void write_part(std::string& out, const mpfr_srcptr x)
+    {
+        const mpfr_prec_t prec = mpfr_get_prec(x);
+        const binary_part_header header{
+            .precision = prec,
+            .kind = mpfr_custom_get_kind(x),
+            .reserved = 0,
+            .exponent = mpfr_regular_p(x) ? mpfr_custom_get_exp(x) : 0
+        };
+        out.append(reinterpret_cast<const char*>(&header), sizeof header);
+
+        const size_t start = out.size();
+        out.resize(start + padded_significand_size(prec));
+        if (mpfr_regular_p(x))
+            std::memcpy(out.data() + start, mpfr_custom_get_significand(x), mpfr_custom_get_size(prec));
+    }
+
+    // Returns the size of the part at the start of in, or 0 if it is truncated or could not have come from MPFR.
+    size_t part_size(const std::string_view in, binary_part_header& header)
+    {
+        if (in.size() < sizeof header)
+            return 0;
+        std::memcpy(&header, in.data(), sizeof header);
+
+        // Checking the precision against the bytes left first keeps the size computation from overflowing
+        if (header.precision < MPFR_PREC_MIN || static_cast<uint64_t>(header.precision) > in.size() * CHAR_BIT)
+            return 0;
+        if (header.kind < -MPFR_REGULAR_KIND || header.kind > MPFR_REGULAR_KIND)
+            return 0;
+
+        const size_t size = sizeof header + padded_significand_size(header.precision);
+        if (in.size() < size)
+            return 0;
+
+        if (std::abs(header.kind) == MPFR_REGULAR_KIND)
+        {
+            if (header.exponent < mpfr_get_emin() || header.exponent > mpfr_get_emax())
+                return 0;
+
+            mp_limb_t top;
+            const size_t top_offset = sizeof header + (significand_limbs(header.precision) - 1) * sizeof top;
+            std::memcpy(&top, in.data() + top_offset, sizeof top);
+            if ((top >> (GMP_NUMB_BITS - 1)) == 0) // Regular significands are normalized
+                return 0;
+        }
+        return size;
+    }
+
+    void read_part(const std::string_view in, const binary_part_header& header, const mpfr_ptr x)
+    {
+        // A custom mpfr_t over an aligned copy of the stored significand, which x, allocated by mpfr_init2, then
+        // copies exactly at the same precision
+        std::vector<mp_limb_t> limbs(significand_limbs(header.precision));
+        std::memcpy(limbs.data(), in.data() + sizeof header, mpfr_custom_get_size(header.precision));
+        const auto unused_bits = static_cast<unsigned>(limbs.size() * GMP_NUMB_BITS - header.precision);
+        limbs[0] &= ~((mp_limb_t{1} << unused_bits) - 1);
+
+        mpfr_t stored;
+        mpfr_custom_init(limbs.data(), header.precision);
+        mpfr_custom_init_set(stored, header.kind, header.exponent, header.precision, limbs.data());
+
+        if (mpfr_get_prec(x) != header.precision)
+            mpfr_set_prec(x, header.precision);
+        mpfr_set(x, stored, fr_round_mode);
+    }
+}
+
+void number::write_binary(std::string& out) const
+{
+    write_part(out, d->real_ref());
+    write_part(out, d->imag_ref());
+}
+
+size_t number::binary_size(const std::string_view in)
+{
+    binary_part_header header{};
+    const size_t real_size = part_size(in, header);
+    if (real_size == 0)
+        return 0;
+    const size_t imag_size = part_size(in.substr(real_size), header);
+    return imag_size == 0 ? 0 : real_size + imag_size;
+}
+
+bool number::read_binary(std::string_view& in)
+{
+    binary_part_header real_header{};
+    binary_part_header imag_header{};
+    const size_t real_size = part_size(in, real_header);
+    if (real_size == 0)
+        return false;
+    const size_t imag_size = part_size(in.substr(real_size), imag_header);
+    if (imag_size == 0)
+        return false;
+
+    read_part(in, real_header, d->real_ref());
+    read_part(in.substr(real_size), imag_header, d->imag_ref());
+    in.remove_prefix(real_size + imag_size);
+    return true;
+}
+
 number number::pi(const long prec)
 {
     number pi{prec};
-    mpfr_const_pi(pi.d->real_ref(), fr_round_mode);
+    const_pi(pi.d->real_ref());
     return pi;
 }
 
@@ -526,3 +934,8 @@ number number::e(const long prec)
     mpfr_clear(fr_one);
     return e;
 }
+
+void number::free_thread_caches()
+{
+    mpfr_free_cache2(MPFR_FREE_LOCAL_CACHE);
+}
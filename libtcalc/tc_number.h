@@ -3,6 +3,7 @@
 
 #include <memory>
 #include <string>
+#include <string_view>
 
 namespace tcalc
 {
@@ -31,6 +32,20 @@ namespace tcalc
         void set_imaginary(long im);
         void set_binary(std::string_view bin);
         void set_hexadecimal(std::string_view hex);
+        // Sets this to x with a zero imaginary part, rounded only if this number's precision is below that of x.
+        void set_double(double x);
+        void set_long_double(long double x);
+
+        // The real part rounded to the nearest double or long double.
+        [[nodiscard]]
+        double real_double() const;
+        [[nodiscard]]
+        long double real_long_double() const;
+
+        // The exponent e of the real part written as m * 2^e with 1/2 <= |m| < 1. The real part must be finite and
+        // nonzero.
+        [[nodiscard]]
+        long real_exponent() const;
 
         [[nodiscard]]
         bool is_real() const;
@@ -50,6 +65,12 @@ namespace tcalc
         [[nodiscard]]
         bool operator==(long r) const;
 
+        [[nodiscard]]
+        bool operator<(long r) const;
+
+        [[nodiscard]]
+        bool operator>(long r) const;
+
         [[nodiscard]]
         bool operator<(const number& b) const;
 
@@ -67,6 +88,8 @@ namespace tcalc
         void negate(const number& x);
         void mul(const number& lhs, const number& rhs);
         void mul(const number& lhs, long rhs);
+        // Sets this to x * 2^exponent, which is exact unless it leaves the exponent range.
+        void mul_2exp(const number& x, long exponent);
         void div(const number& lhs, const number& rhs);
         void div(const number& lhs, unsigned long rhs);
         void pow(const number& lhs, const number& rhs);
@@ -81,6 +104,8 @@ namespace tcalc
         void sin(const number& x);
         void cos(const number& x);
         void tan(const number& x);
+        // Sets this to sin(x) and cos_out to cos(x) with a single argument reduction; cos_out must not alias either.
+        void sin_cos(number& cos_out, const number& x);
         void abs(const number& x);
         void re(const number& x);
         void im(const number& x);
@@ -96,6 +121,16 @@ namespace tcalc
         void acosh(const number& x);
         void atanh(const number& x);
 
+        // Trigonometric functions taking or producing angles in units where a full turn is `turn`, e.g. 360 for
+        // degrees. They use only the real part of x and round correctly, so exact values such as sin(30) are exact.
+        void sin(const number& x, unsigned long turn);
+        void cos(const number& x, unsigned long turn);
+        void tan(const number& x, unsigned long turn);
+        void asin(const number& x, unsigned long turn);
+        void acos(const number& x, unsigned long turn);
+        void atan(const number& x, unsigned long turn);
+        void arg(const number& x, unsigned long turn);
+
         [[nodiscard]]
         std::string string() const;
         [[nodiscard]]
@@ -104,10 +139,27 @@ namespace tcalc
         [[nodiscard]]
         std::string dbg_string() const;
 
+        // Appends the exact binary image of the number: the precision, sign and exponent of each part and the raw limbs
+        // of its significand. The image is only readable on a machine with the same limb size and byte order. Its size
+        // is a multiple of 8 bytes.
+        void write_binary(std::string& out) const;
+
+        // Returns the size of the binary image at the start of in, or 0 if in does not start with a valid one.
+        [[nodiscard]]
+        static size_t binary_size(std::string_view in);
+
+        // Reads the binary image at the start of in and advances past it. The number takes the stored precision.
+        // Returns false, leaving the number unchanged, if in does not start with a valid image.
+        bool read_binary(std::string_view& in);
+
         static number pi(long prec);
         static number tau(long prec);
         static number e(long prec);
 
+        // Frees the constants and scratch memory MPFR caches for the calling thread. Threads that evaluate numbers call
+        // it before they exit; the caches are rebuilt on demand if the thread keeps computing.
+        static void free_thread_caches();
+
     private:
         std::unique_ptr<number_pimpl> d;
     };
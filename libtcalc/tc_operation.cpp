@@ -16,10 +16,11 @@ std::string tcalc::op_to_string(const operation &op)
         return std::format("({})@{}-{}", num->num.string(), num->position.start_index, num->position.end_index);
 
     if (const auto* var = std::get_if<variable_reference>(&op))
-        return std::format("({})@{}-{}", var->identifier, var->position.start_index, var->position.end_index);
+        return std::format("({})@{}-{}", var->identifier.name(), var->position.start_index, var->position.end_index);
 
     if (const auto* fn = std::get_if<function_call>(&op))
-        return std::format("[{}/{}]@{}-{}", fn->identifier, fn->arity, fn->position.start_index, fn->position.end_index);
+        return std::format("[{}/{}]@{}-{}", fn->identifier.name(), fn->arity, fn->position.start_index,
+                           fn->position.end_index);
 
     return {};
 }
@@ -6,6 +6,7 @@
 
 #include "tc_token.h"
 #include "tc_number.h"
+#include "tc_symbol.h"
 
 namespace tcalc
 {
@@ -29,7 +30,7 @@ namespace tcalc
 
     struct variable_reference final
     {
-        std::string identifier;
+        symbol identifier;
         source_position position;
     };
 
@@ -37,7 +38,7 @@ namespace tcalc
 
     struct function_call final
     {
-        std::string identifier;
+        symbol identifier;
         fn_arity_t arity;
         source_position position;
     };
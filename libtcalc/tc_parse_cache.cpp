@@ -0,0 +1,76 @@
+#include "tc_parse_cache.h"
+
+#include <functional>
+#include <stdexcept>
+
+#include "tc_lexer.h"
+#include "tc_parser.h"
+
+using namespace tcalc;
+
+parse_cache::parse_cache(const size_t capacity) : _capacity{capacity}
+{
+    if (capacity == 0)
+        throw std::invalid_argument{"capacity"};
+}
+
+size_t parse_cache::key_hash::operator()(const key_view& key) const noexcept
+{
+    const size_t h = std::hash<std::string_view>{}(key.input);
+    const size_t settings = std::hash<long>{}(key.number_precision) * 2 + (key.comma_arg_separator ? 1 : 0);
+    return h ^ (settings + 0x9e3779b97f4a7c15 + (h << 6) + (h >> 2));
+}
+
+std::shared_ptr<const parse_result> parse_cache::parse(const std::string_view input, const bool comma_arg_separator,
+                                                       const long number_precision)
+{
+    const key_view key{input, comma_arg_separator, number_precision};
+
+    {
+        std::lock_guard lock{_mutex};
+        if (const auto it = _index.find(key); it != _index.end())
+        {
+            _hits++;
+            _entries.splice(_entries.begin(), _entries, it->second);
+            return it->second->result;
+        }
+        _misses++;
+    }
+
+    // Parse without holding the lock, so that misses on other threads are not serialized behind this one.
+    auto result = std::make_shared<parse_result>();
+    parser p{lexer::borrowing(input, comma_arg_separator), number_precision};
+    result->expressions = p.parse_all();
+    result->diagnostics = p.diagnostic_bag();
+
+    std::lock_guard lock{_mutex};
+    if (const auto it = _index.find(key); it != _index.end())
+        return it->second->result; // Another thread parsed the same input meanwhile
+
+    _entries.push_front({std::string{input}, comma_arg_separator, number_precision, std::move(result)});
+    const entry& added = _entries.front();
+    _index.emplace(key_view{added.input, comma_arg_separator, number_precision}, _entries.begin());
+
+    if (_entries.size() > _capacity)
+    {
+        const entry& oldest = _entries.back();
+        _index.erase(key_view{oldest.input, oldest.comma_arg_separator, oldest.number_precision});
+        _entries.pop_back();
+        _evictions++;
+    }
+
+    return added.result;
+}
+
+parse_cache::statistics parse_cache::stats() const
+{
+    std::lock_guard lock{_mutex};
+    return {_hits, _misses, _evictions, _entries.size()};
+}
+
+void parse_cache::clear()
+{
+    std::lock_guard lock{_mutex};
+    _index.clear();
+    _entries.clear();
+}
@@ -0,0 +1,84 @@
+#ifndef TC_PARSE_CACHE_H
+#define TC_PARSE_CACHE_H
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "tc_diagnostic.h"
+#include "tc_expression.h"
+
+namespace tcalc
+{
+    struct parse_result final
+    {
+        std::vector<expression> expressions;
+        std::vector<diagnostic> diagnostics;
+    };
+
+    // A bounded, thread-safe, least recently used cache of parse_all results, keyed by the input text and the settings
+    // that change how it parses. Results are shared and immutable, so a hit never copies the literals inside them.
+    class parse_cache final
+    {
+    public:
+        struct statistics
+        {
+            uint64_t hits;
+            uint64_t misses;
+            uint64_t evictions;
+            size_t size;
+        };
+
+        explicit parse_cache(size_t capacity);
+
+        parse_cache(const parse_cache&) = delete;
+        parse_cache& operator=(const parse_cache&) = delete;
+
+        // Parses the input, or returns the result of an earlier identical parse.
+        std::shared_ptr<const parse_result> parse(std::string_view input, bool comma_arg_separator,
+                                                  long number_precision);
+
+        [[nodiscard]]
+        statistics stats() const;
+
+        void clear();
+
+    private:
+        struct key_view
+        {
+            std::string_view input;
+            bool comma_arg_separator;
+            long number_precision;
+
+            bool operator==(const key_view&) const = default;
+        };
+
+        struct key_hash
+        {
+            size_t operator()(const key_view& key) const noexcept;
+        };
+
+        struct entry
+        {
+            std::string input;
+            bool comma_arg_separator;
+            long number_precision;
+            std::shared_ptr<const parse_result> result;
+        };
+
+        size_t _capacity;
+        mutable std::mutex _mutex;
+        std::list<entry> _entries; // Most recently used first
+        std::unordered_map<key_view, std::list<entry>::iterator, key_hash> _index; // Keys view into _entries
+        uint64_t _hits = 0;
+        uint64_t _misses = 0;
+        uint64_t _evictions = 0;
+    };
+}
+
+#endif // TC_PARSE_CACHE_H
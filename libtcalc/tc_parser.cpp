@@ -1,5 +1,9 @@
 #include "tc_parser.h"
 
+#include <algorithm>
+#include <stdexcept>
+
+#include "internal/trace.h"
 #include "internal/utf8utils.h"
 
 using namespace tcalc;
@@ -112,6 +116,30 @@ namespace
                 return false;
         }
     }
+
+    // The most operands an evaluation of the operations holds at once, so the evaluator can size its stack up front.
+    size_t max_stack_depth(const std::vector<operation>& ops)
+    {
+        size_t depth = 0;
+        size_t max_depth = 0;
+        for (const auto& op : ops)
+        {
+            if (std::holds_alternative<literal_number>(op) || std::holds_alternative<variable_reference>(op))
+                depth++;
+            else if (std::holds_alternative<binary_operator>(op))
+                depth -= std::min<size_t>(depth, 1);
+            else if (const auto* call = std::get_if<function_call>(&op))
+                depth = depth - std::min(depth, static_cast<size_t>(call->arity)) + 1;
+            max_depth = std::max(max_depth, depth);
+        }
+        return max_depth;
+    }
+
+    arithmetic_expression make_arithmetic(std::vector<operation>&& ops, const source_position position)
+    {
+        const size_t depth = max_stack_depth(ops);
+        return arithmetic_expression{.tokens = std::move(ops), .position = position, .max_stack_depth = depth};
+    }
 } // End anonymous namespace
 
 std::vector<expression> parser::parse_all()
@@ -124,6 +152,18 @@ std::vector<expression> parser::parse_all()
     return exprs;
 }
 
+void parser::parse_all(std::vector<expression>& out)
+{
+    size_t count = 0;
+    do
+    {
+        if (count == out.size())
+            out.emplace_back();
+        parse_expression(out[count++]);
+    } while(!at_end());
+    out.resize(count);
+}
+
 expression parser::parse_variable_assignment(const size_t lhs_start_ix, std::vector<operation>&& lhs_parse)
 {
     forward(); // consume equals token
@@ -133,13 +173,10 @@ expression parser::parse_variable_assignment(const size_t lhs_start_ix, std::vec
     parse_arithmetic(rhs_parse);
     const size_t rhs_end_ix = _current.end_index();
     expect_end();
-    auto var = std::get<variable_reference>(lhs_parse[0]).identifier;
+    const symbol var = std::get<variable_reference>(lhs_parse[0]).identifier;
     return assignment_expression{
-        .variable = std::move(var),
-        .expression = arithmetic_expression{
-            .tokens = std::move(rhs_parse),
-            .position = {rhs_start_ix, rhs_end_ix}
-        },
+        .variable = var,
+        .expression = make_arithmetic(std::move(rhs_parse), {rhs_start_ix, rhs_end_ix}),
         .position = {lhs_start_ix, rhs_end_ix}
     };
 }
@@ -153,14 +190,8 @@ expression parser::parse_boolean_expression(const size_t lhs_start_ix, const siz
     const size_t rhs_end_ix = _current.end_index();
     expect_end();
     return boolean_expression{
-        .lhs = arithmetic_expression{
-            .tokens = std::move(lhs_parse),
-            .position = {lhs_start_ix, lhs_end_ix}
-        },
-        .rhs = arithmetic_expression{
-            .tokens = std::move(rhs_parse),
-            .position = {rhs_start_ix, rhs_end_ix}
-        },
+        .lhs = make_arithmetic(std::move(lhs_parse), {lhs_start_ix, lhs_end_ix}),
+        .rhs = make_arithmetic(std::move(rhs_parse), {rhs_start_ix, rhs_end_ix}),
         .kind = delimiter == token_kind::equal ? token_kind::equality : delimiter,
         .position = {lhs_start_ix, rhs_end_ix}
     };
@@ -168,16 +199,36 @@ expression parser::parse_boolean_expression(const size_t lhs_start_ix, const siz
 
 expression parser::parse_expression()
 {
-    const size_t lhs_start_ix = _current.start_index();
+    trace_detail::span trace{"parser::parse_expression"};
+    return parse_expression(std::vector<operation>{});
+}
 
+void parser::parse_expression(expression& out)
+{
+    trace_detail::span trace{"parser::parse_expression"};
     std::vector<operation> lhs_parse;
+    if (auto* arith = std::get_if<arithmetic_expression>(&out))
+        lhs_parse = std::move(arith->tokens);
+    else if (auto* asgn = std::get_if<assignment_expression>(&out))
+        lhs_parse = std::move(asgn->expression.tokens);
+    else if (auto* boolean = std::get_if<boolean_expression>(&out))
+        lhs_parse = std::move(boolean->lhs.tokens);
+
+    lhs_parse.clear();
+    out = parse_expression(std::move(lhs_parse));
+}
+
+expression parser::parse_expression(std::vector<operation>&& lhs_parse)
+{
+    const size_t lhs_start_ix = _current.start_index();
+
     parse_arithmetic(lhs_parse); // Parse full expression or left hand side of function call or assignment
     const size_t lhs_end_ix = _current.start_index();
 
     if (lhs_parse.empty())
     {
         expect_end();
-        return arithmetic_expression{{}, {lhs_start_ix, lhs_end_ix}};
+        return make_arithmetic({}, {lhs_start_ix, lhs_end_ix});
     }
 
     switch (_current.kind())
@@ -196,55 +247,103 @@ expression parser::parse_expression()
             return parse_boolean_expression(lhs_start_ix, lhs_end_ix, std::move(lhs_parse), forward().kind());
         default:
             expect_end();
-            return arithmetic_expression{std::move(lhs_parse), {lhs_start_ix, lhs_end_ix}};
+            return make_arithmetic(std::move(lhs_parse), {lhs_start_ix, lhs_end_ix});
     }
 }
 
-// The parsing functions share a single vector around, placing elements onto the parse stack as necessary.
-void parser::parse_arithmetic(std::vector<operation>& parsing, const int enclosing_precedence, const bool enclosing_right_assoc)
+// Precedence climbing over an explicit stack of frames instead of native recursion, so that deeply nested input costs
+// memory linear in its depth, up to max_nesting_depth, instead of overflowing the native stack. Each frame parses one
+// operand followed by operators binding tighter than its enclosing precedence, and on finishing hands control back to
+// the frame below through its resume action. All frames share a single output vector, placing elements onto the parse
+// stack as necessary.
+void parser::parse_arithmetic(std::vector<operation>& parsing)
+{
+    _frames.clear();
+    _frames.push_back({-1, false, frame_resume::done, token_kind::bad, {}, {}, 0});
+
+    arithmetic_step step = arithmetic_step::operand;
+    while (true)
+    {
+        switch (step)
+        {
+            case arithmetic_step::operand:
+                step = parse_operand(parsing);
+                break;
+            case arithmetic_step::operators:
+                step = parse_operators(parsing);
+                break;
+            case arithmetic_step::finish:
+                step = finish_frame(parsing);
+                break;
+            case arithmetic_step::too_deep:
+                _lexer.diagnostic_bag().emplace_back(_current.position(), diagnostic_type::nesting_too_deep);
+                while (!ends_expr(_current.kind()))
+                    forward();
+                _frames.clear();
+                return;
+            case arithmetic_step::abandon:
+                while (!ends_expr(_current.kind()))
+                    forward();
+                _frames.clear();
+                return;
+            case arithmetic_step::done:
+                return;
+        }
+    }
+}
+
+parser::arithmetic_step parser::push_frame(const arithmetic_frame& frame)
+{
+    if (_frames.size() >= max_nesting_depth)
+        return arithmetic_step::too_deep;
+    _frames.push_back(frame);
+    return arithmetic_step::operand;
+}
+
+parser::arithmetic_step parser::parse_operand(std::vector<operation>& parsing)
 {
     const int unary_prec = unary_precendence(_current.kind());
     if (unary_prec == -1) // not unary operator
     {
         // Must parse some sort of primary term (a function call, a parenthesized expression, etc.)
-        parse_primary_term(parsing);
+        return parse_primary_term(parsing);
     }
-    else
+
+    // We have a unary operator
+    const auto unary_op = forward();
+    if (unary_op.kind() == token_kind::superscript_literal)
     {
-        // We have a unary operator
-        const auto unary_op = forward();
-        if (unary_op.kind() == token_kind::superscript_literal)
+        // Expect to read nth root expression of form ⁿ√x
+        if (_current.kind() != token_kind::radical)
         {
-            // Expect to read nth root expression of form ⁿ√x
-            if (_current.kind() != token_kind::radical)
-            {
-                unexpected_token(unary_op);
-                return;
-            }
-
-            const auto radical = forward();
-            const auto num_str = utf8utils::to_inline_number(unary_op.source());
-            if (num_str.find('i') != std::string::npos)
-            {
-                _diagnostic_bag.emplace_back(unary_op.position(), diagnostic_type::invalid_number_literal);
-                return;
-            }
-            number num{_number_precision};
-            num.set_real(num_str);
-            parsing.emplace_back(literal_number{std::move(num), unary_op.position()});
-            // actually "binary" operator
-            parse_arithmetic(parsing, unary_prec);
-            const source_position pos{unary_op.start_index(), radical.end_index()};
-            parsing.emplace_back(binary_operator{token_kind::radical, pos});
+            unexpected_token(unary_op);
+            return arithmetic_step::finish;
         }
-        else
+
+        const auto radical = forward();
+        const auto num_str = utf8utils::to_inline_number(unary_op.source());
+        if (num_str.find('i') != std::string::npos)
         {
-            // read unary operand
-            parse_arithmetic(parsing, unary_prec);
-            parsing.emplace_back(unary_operator{unary_op.kind(), unary_op.position()}); // And place the unary operator on the stack
+            _lexer.diagnostic_bag().emplace_back(unary_op.position(), diagnostic_type::invalid_number_literal);
+            return arithmetic_step::finish;
         }
+        number num{_number_precision};
+        num.set_real(num_str);
+        parsing.emplace_back(literal_number{std::move(num), unary_op.position()});
+        // actually "binary" operator, placed once its right hand side is parsed
+        const source_position pos{unary_op.start_index(), radical.end_index()};
+        return push_frame({unary_prec, false, frame_resume::radical, token_kind::radical, pos, {}, 0});
     }
 
+    // read unary operand, then place the unary operator on the stack
+    return push_frame({unary_prec, false, frame_resume::unary, unary_op.kind(), unary_op.position(), {}, 0});
+}
+
+parser::arithmetic_step parser::parse_operators(std::vector<operation>& parsing)
+{
+    const int enclosing_precedence = _frames.back().enclosing_precedence;
+    const bool enclosing_right_assoc = _frames.back().enclosing_right_assoc;
+
     while (true)
     {
         auto prec = binary_precedence(_current.kind());
@@ -257,7 +356,7 @@ void parser::parse_arithmetic(std::vector<operation>& parsing, const int enclosi
             position = _current.position();
 
             if (enclosing_right_assoc ? prec < enclosing_precedence : prec <= enclosing_precedence)
-                return;
+                return arithmetic_step::finish;
 
             forward();
         }
@@ -269,7 +368,7 @@ void parser::parse_arithmetic(std::vector<operation>& parsing, const int enclosi
             position = {_current.position().start_index, _current.position().start_index};
 
             if (enclosing_right_assoc ? prec < enclosing_precedence : prec <= enclosing_precedence)
-                return;
+                return arithmetic_step::finish;
         }
         else if (is_superscript(_current.kind()))
         {
@@ -285,30 +384,74 @@ void parser::parse_arithmetic(std::vector<operation>& parsing, const int enclosi
         }
         else
         {
-            return; // if not a kind that starts a term, or binary operator, stop.
+            return arithmetic_step::finish; // if not a kind that starts a term, or binary operator, stop.
         }
 
-        // parse right-hand side, up to where the operator precedence will allow us
-        parse_arithmetic(parsing, prec, is_right_associative(op_kind));
-        parsing.emplace_back(binary_operator{op_kind, position}); // and put operator
+        // parse right-hand side, up to where the operator precedence will allow us, and then put the operator
+        return push_frame({prec, is_right_associative(op_kind), frame_resume::binary, op_kind, position, {}, 0});
     }
 }
 
-void parser::parse_primary_term(std::vector<operation>& parsing)
+parser::arithmetic_step parser::finish_frame(std::vector<operation>& parsing)
+{
+    arithmetic_frame frame = _frames.back();
+    _frames.pop_back();
+
+    switch (frame.resume)
+    {
+        case frame_resume::done:
+            return arithmetic_step::done;
+        case frame_resume::unary:
+            parsing.emplace_back(unary_operator{frame.op_kind, frame.position});
+            return arithmetic_step::operators;
+        case frame_resume::radical:
+        case frame_resume::binary:
+            parsing.emplace_back(binary_operator{frame.op_kind, frame.position});
+            return arithmetic_step::operators;
+        case frame_resume::parenthesis:
+            // like a lot of calculators, silenty ignore missing close parens
+            if (_current.kind() == token_kind::close_parenthesis)
+                forward();
+            return arithmetic_step::operators;
+        case frame_resume::function_argument:
+            frame.arity++;
+            if (_current.kind() == token_kind::argument_separator)
+            {
+                forward();
+                _frames.push_back(frame); // Parse the next argument in place of this one
+                return arithmetic_step::operand;
+            }
+
+            if (_current.kind() == token_kind::close_parenthesis)
+                forward();
+
+        {
+            const auto name = intern(frame.function_name, frame.position);
+            if (!name)
+                return arithmetic_step::abandon;
+            parsing.emplace_back(function_call{*name, frame.arity, frame.position});
+            return arithmetic_step::operators;
+        }
+    }
+
+    throw std::logic_error{"unreachable"};
+}
+
+parser::arithmetic_step parser::parse_primary_term(std::vector<operation>& parsing)
 {
     switch(_current.kind())
     {
         case token_kind::identifier:
             if (peek().kind() != token_kind::open_parenthesis)
             {
-                parsing.emplace_back(variable_reference{std::string{_current.source()}, _current.position()});
+                const auto name = intern(_current.source(), _current.position());
+                if (!name)
+                    return arithmetic_step::abandon;
+                parsing.emplace_back(variable_reference{*name, _current.position()});
                 forward();
+                return arithmetic_step::operators;
             }
-            else
-            {
-                parse_function(parsing);
-            }
-            return;
+            return parse_function(parsing);
         case token_kind::numeric_literal:
         {
             number num{_number_precision};
@@ -325,7 +468,7 @@ void parser::parse_primary_term(std::vector<operation>& parsing)
             }
             const auto token = forward();
             parsing.emplace_back(literal_number{std::move(num), token.position()});
-            return;
+            return arithmetic_step::operators;
         }
         case token_kind::binary_literal:
         {
@@ -333,7 +476,7 @@ void parser::parse_primary_term(std::vector<operation>& parsing)
             num.set_binary(_current.source());
             parsing.emplace_back(literal_number{std::move(num), _current.position()});
             forward();
-            return;
+            return arithmetic_step::operators;
         }
         case token_kind::hex_literal:
         {
@@ -341,18 +484,14 @@ void parser::parse_primary_term(std::vector<operation>& parsing)
             num.set_hexadecimal(_current.source());
             parsing.emplace_back(literal_number{std::move(num), _current.position()});
             forward();
-            return;
+            return arithmetic_step::operators;
         }
         case token_kind::open_parenthesis:
             forward();
-            parse_arithmetic(parsing);
-            // like a lot of calculators, silenty ignore missing close parens
-            if (_current.kind() == token_kind::close_parenthesis)
-                forward();
-            return;
+            return push_frame({-1, false, frame_resume::parenthesis, token_kind::bad, {}, {}, 0});
         default:
             unexpected_token(forward());
-            return;
+            return arithmetic_step::operators;
     }
 }
 
@@ -442,40 +581,39 @@ void parser::parse_superscript(std::vector<operation>& parsing)
     }
 }
 
-void parser::parse_function(std::vector<operation>& parsing)
+parser::arithmetic_step parser::parse_function(std::vector<operation>& parsing)
 {
     const auto name_token = forward(); // Consume name token
     const auto position = name_token.position();
-    std::string fn_name{name_token.source()};
 
     forward(); // Consume open parens
 
     if (_current.kind() == token_kind::close_parenthesis)
     {
         forward();
-        parsing.emplace_back(function_call{std::move(fn_name), 0, position});
-        return;
+        const auto name = intern(name_token.source(), position);
+        if (!name)
+            return arithmetic_step::abandon;
+        parsing.emplace_back(function_call{*name, 0, position});
+        return arithmetic_step::operators;
     }
-    int arity = 0;
-    while (true)
-    {
-        parse_arithmetic(parsing);
-        arity++;
 
-        if (_current.kind() == token_kind::argument_separator)
-            forward();
-        else
-            break;
-    }
-
-    if (_current.kind() == token_kind::close_parenthesis)
-        forward();
+    // Each argument is parsed in its own frame, which counts it and continues with the next one when it finishes
+    return push_frame({-1, false, frame_resume::function_argument, token_kind::bad, position, name_token.source(), 0});
+}
 
-    parsing.emplace_back(function_call{std::move(fn_name), arity, position});
+// Identifiers are interned at parse time, but input may be untrusted, so new names stop being accepted once the
+// interner is full.
+std::optional<symbol> parser::intern(const std::string_view name, const source_position position)
+{
+    auto sym = symbol::try_intern(name);
+    if (!sym)
+        _lexer.diagnostic_bag().emplace_back(position, diagnostic_type::too_many_symbols);
+    return sym;
 }
 
 void parser::unexpected_token(const token& err_token)
 {
-    _diagnostic_bag.emplace_back(err_token.position(), diagnostic_type::unexpected_token,
-                                 token_kind_name(err_token.kind()));
+    _lexer.diagnostic_bag().emplace_back(err_token.position(), diagnostic_type::unexpected_token,
+                                         token_kind_name(err_token.kind()));
 }
\ No newline at end of file
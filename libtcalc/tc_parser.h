@@ -1,6 +1,8 @@
 #ifndef TC_PARSER_H
 #define TC_PARSER_H
 
+#include <optional>
+
 #include "tc_expression.h"
 #include "tc_lexer.h"
 
@@ -9,17 +11,34 @@ namespace tcalc
     class parser final
     {
     public:
+        // Deepest nesting of parentheses, arguments and operands that one expression may have.
+        static constexpr size_t max_nesting_depth = 1 << 18;
+
+        // The parser owns the lexer, and with it the source text that its tokens view.
         explicit parser(lexer&& lexer, const long number_precision) :
-            _current{lexer.next()},
             _lexer{std::move(lexer)},
-            _diagnostic_bag{_lexer.diagnostic_bag()},
+            _current{_lexer.next()},
             _number_precision{number_precision}
         {
         }
 
+        // Starts parsing a new borrowed input from the given byte index, which must be where a token starts or where
+        // lexing would otherwise skip to it. The caller must keep the input alive while parsing.
+        void reset(const std::string_view input, const size_t start_index = 0)
+        {
+            _lexer.reset(input, start_index);
+            _peek = std::nullopt;
+            _current = _lexer.next();
+        }
+
         std::vector<expression> parse_all();
         expression parse_expression();
 
+        // These overwrite their output while reusing the capacity of the operation vectors already in it, so a loop
+        // that resets and parses into the same output stops allocating for them once warmed up.
+        void parse_all(std::vector<expression>& out);
+        void parse_expression(expression& out);
+
         [[nodiscard]]
         bool at_end() const
         {
@@ -29,7 +48,21 @@ namespace tcalc
         [[nodiscard]]
         const std::vector<diagnostic>& diagnostic_bag() const
         {
-            return _diagnostic_bag;
+            return _lexer.diagnostic_bag();
+        }
+
+        // Where the next expression starts; between expressions, parsing only depends on the input from here on.
+        [[nodiscard]]
+        size_t next_start_index() const
+        {
+            return _current.start_index();
+        }
+
+        // One past the last byte of input the parse so far has depended on.
+        [[nodiscard]]
+        size_t read_extent() const
+        {
+            return _lexer.read_extent();
         }
 
     private:
@@ -51,22 +84,60 @@ namespace tcalc
             return *_peek;
         }
 
-        void parse_arithmetic(std::vector<operation> &parsing, int enclosing_precedence = -1, bool enclosing_right_assoc = false);
-        void parse_function(std::vector<operation>& parsing);
+        enum class arithmetic_step
+        {
+            operand,
+            operators,
+            finish,
+            too_deep,
+            abandon, // A diagnostic has been reported; skip the rest of the expression
+            done
+        };
+
+        // What to do with the output once a frame's operand and operators have been parsed.
+        enum class frame_resume
+        {
+            done,
+            unary,
+            radical,
+            binary,
+            parenthesis,
+            function_argument
+        };
+
+        struct arithmetic_frame
+        {
+            int enclosing_precedence;
+            bool enclosing_right_assoc;
+            frame_resume resume;
+            token_kind op_kind;
+            source_position position;
+            std::string_view function_name;
+            fn_arity_t arity;
+        };
+
+        void parse_arithmetic(std::vector<operation>& parsing);
+        arithmetic_step push_frame(const arithmetic_frame& frame);
+        arithmetic_step parse_operand(std::vector<operation>& parsing);
+        arithmetic_step parse_operators(std::vector<operation>& parsing);
+        arithmetic_step finish_frame(std::vector<operation>& parsing);
+        arithmetic_step parse_function(std::vector<operation>& parsing);
+        std::optional<symbol> intern(std::string_view name, source_position position);
         void unexpected_token(const token& err_token);
-        void parse_primary_term(std::vector<operation> &parsing);
+        arithmetic_step parse_primary_term(std::vector<operation>& parsing);
         void expect_end();
         void parse_super_num(std::vector<operation>& parsing);
         void parse_super_term(std::vector<operation>& parsing);
         void parse_superscript(std::vector<operation>& parsing);
+        expression parse_expression(std::vector<operation>&& lhs_parse);
         expression parse_variable_assignment(size_t lhs_start_ix, std::vector<operation>&& lhs_parse);
         expression parse_boolean_expression(size_t lhs_start_ix, size_t lhs_end_ix, std::vector<operation>&& lhs_parse,
                                             token_kind delimiter);
+        lexer _lexer;
         token _current;
         std::optional<token> _peek;
-        lexer _lexer;
-        std::vector<diagnostic>& _diagnostic_bag;
         long _number_precision;
+        std::vector<arithmetic_frame> _frames;
     };
 
     template<class ExprT> requires std::convertible_to<ExprT, expression>
@@ -76,9 +147,21 @@ namespace tcalc
         const expression expr = p.parse_expression();
 
         if (const ExprT* t_exp = std::get_if<ExprT>(&expr))
-            return {p, *t_exp};
+            return {std::move(p), *t_exp};
+
+        return {std::move(p), std::nullopt};
+    }
+
+    template<class ExprT> requires std::convertible_to<ExprT, expression>
+    std::optional<ExprT> parse_single(parser& p, const std::string_view input)
+    {
+        p.reset(input);
+        expression expr = p.parse_expression();
+
+        if (ExprT* t_exp = std::get_if<ExprT>(&expr))
+            return std::move(*t_exp);
 
-        return {p, std::nullopt};
+        return std::nullopt;
     }
 }
 
@@ -0,0 +1,288 @@
+#include "tc_pipeline.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <map>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "tc_lexer.h"
+#include "tc_parser.h"
+#include "internal/bounded_queue.h"
+
+using namespace tcalc;
+
+namespace
+{
+    using clock = std::chrono::steady_clock;
+
+    struct parse_job
+    {
+        uint64_t sequence;
+        std::string input;
+        bool end;
+    };
+
+    struct eval_job
+    {
+        uint64_t sequence;
+        std::vector<expression> expressions;
+        std::string output; // Already final when parsing failed
+        bool end;
+    };
+
+    struct write_job
+    {
+        uint64_t sequence;
+        std::string output;
+        bool end;
+    };
+
+    struct stage_counter
+    {
+        std::atomic<uint64_t> items{0};
+        std::atomic<int64_t> busy_ns{0};
+        std::atomic<size_t> max_queue_depth{0};
+
+        void add(const clock::duration busy, const uint64_t count = 1)
+        {
+            items.fetch_add(count, std::memory_order_relaxed);
+            busy_ns.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(busy).count(),
+                              std::memory_order_relaxed);
+        }
+
+        void observe_depth(const size_t depth)
+        {
+            size_t seen = max_queue_depth.load(std::memory_order_relaxed);
+            while (depth > seen && !max_queue_depth.compare_exchange_weak(seen, depth, std::memory_order_relaxed))
+            {
+            }
+        }
+    };
+
+    void append_result(std::string& out, const evaluator::result_type& result, const pipeline_options& options)
+    {
+        if (const auto* num = std::get_if<number>(&result))
+            out += num->string(options.digits, options.format);
+        else if (const auto* boolean = std::get_if<bool>(&result))
+            out += *boolean ? "true" : "false";
+        else
+            out += std::get<assign_result>(result).value.string(options.digits, options.format);
+    }
+}
+
+std::string_view tcalc::pipeline_stage_name(const pipeline_stage stage)
+{
+    using namespace std::literals;
+    switch (stage)
+    {
+        case pipeline_stage::read:
+            return "read"sv;
+        case pipeline_stage::parse:
+            return "parse"sv;
+        case pipeline_stage::evaluate:
+            return "evaluate"sv;
+        case pipeline_stage::format:
+            return "format"sv;
+        case pipeline_stage::write:
+            return "write"sv;
+        default:
+            return {};
+    }
+}
+
+pipeline::pipeline(const evaluator& prototype, const pipeline_options& options) :
+    _prototype{prototype},
+    _options{options}
+{
+    if (options.parse_workers == 0 || options.eval_workers == 0)
+        throw std::invalid_argument{"workers"};
+}
+
+pipeline_stats pipeline::run(const std::function<bool(std::string&)>& read,
+                             const std::function<void(std::string_view)>& write)
+{
+    const auto start = clock::now();
+
+    bounded_queue<parse_job> parse_queue{_options.queue_capacity};
+    bounded_queue<eval_job> eval_queue{_options.queue_capacity};
+    bounded_queue<write_job> write_queue{_options.queue_capacity};
+    std::array<stage_counter, 5> counters;
+    auto& [read_counter, parse_counter, eval_counter, format_counter, write_counter] = counters;
+
+    std::atomic<size_t> parse_workers_left{_options.parse_workers};
+    std::atomic<size_t> eval_workers_left{_options.eval_workers};
+    std::vector<std::thread> threads;
+
+    for (size_t i = 0; i < _options.parse_workers; i++)
+    {
+        threads.emplace_back([&]
+        {
+            parser p{lexer::borrowing({}, _options.comma_arg_separator), _prototype.precision()};
+            while (true)
+            {
+                parse_job job = parse_queue.pop();
+                if (job.end)
+                    break;
+
+                const auto busy_start = clock::now();
+                eval_job next{job.sequence, {}, {}, false};
+                if (job.input.find_first_not_of(" \t\r") == std::string::npos)
+                {
+                    // Blank lines give blank output
+                    parse_counter.add(clock::now() - busy_start);
+                    eval_queue.push(std::move(next));
+                    continue;
+                }
+
+                p.reset(job.input);
+                p.parse_all(next.expressions);
+                if (!p.diagnostic_bag().empty())
+                {
+                    next.expressions.clear();
+                    next.output = "error ";
+                    next.output += diagnostic_type_name(p.diagnostic_bag().front().type());
+                }
+                parse_counter.add(clock::now() - busy_start);
+
+                eval_queue.push(std::move(next));
+                eval_counter.observe_depth(eval_queue.depth());
+            }
+
+            if (parse_workers_left.fetch_sub(1) == 1)
+            {
+                for (size_t j = 0; j < _options.eval_workers; j++)
+                    eval_queue.push({0, {}, {}, true});
+            }
+        });
+    }
+
+    for (size_t i = 0; i < _options.eval_workers; i++)
+    {
+        threads.emplace_back([&]
+        {
+            const evaluator local = _prototype;
+            while (true)
+            {
+                eval_job job = eval_queue.pop();
+                if (job.end)
+                    break;
+
+                clock::duration eval_busy{};
+                clock::duration format_busy{};
+                bool first = true;
+                for (const auto& expr : job.expressions)
+                {
+                    auto eval_start = clock::now();
+                    auto res = local.evaluate(expr);
+                    const auto format_start = clock::now();
+                    eval_busy += format_start - eval_start;
+
+                    if (!first)
+                        job.output += "; ";
+                    first = false;
+
+                    if (res.is_error())
+                    {
+                        job.output += "error ";
+                        job.output += eval_error_type_name(res.error().type);
+                        format_busy += clock::now() - format_start;
+                        break;
+                    }
+                    append_result(job.output, res.value(), _options);
+                    format_busy += clock::now() - format_start;
+                }
+                eval_counter.add(eval_busy);
+                format_counter.add(format_busy);
+
+                write_queue.push({job.sequence, std::move(job.output), false});
+                write_counter.observe_depth(write_queue.depth());
+            }
+
+            number::free_thread_caches();
+            if (eval_workers_left.fetch_sub(1) == 1)
+                write_queue.push({0, {}, true});
+        });
+    }
+
+    std::exception_ptr write_error;
+    std::thread writer{[&]
+    {
+        std::map<uint64_t, std::string> pending; // Finished out of order
+        uint64_t next = 0;
+        while (true)
+        {
+            write_job job = write_queue.pop();
+            if (job.end)
+                break;
+
+            pending.emplace(job.sequence, std::move(job.output));
+            for (auto it = pending.begin(); it != pending.end() && it->first == next; it = pending.erase(it), next++)
+            {
+                const auto busy_start = clock::now();
+                if (!write_error)
+                {
+                    try
+                    {
+                        write(it->second);
+                    }
+                    catch (...)
+                    {
+                        write_error = std::current_exception(); // Keep draining so that no worker blocks forever
+                    }
+                }
+                write_counter.add(clock::now() - busy_start);
+            }
+        }
+    }};
+
+    std::exception_ptr read_error;
+    uint64_t sequence = 0;
+    try
+    {
+        while (true)
+        {
+            const auto busy_start = clock::now();
+            std::string input;
+            const bool more = read(input);
+            read_counter.add(clock::now() - busy_start, more ? 1 : 0);
+            if (!more)
+                break;
+
+            parse_queue.push({sequence++, std::move(input), false});
+            parse_counter.observe_depth(parse_queue.depth());
+        }
+    }
+    catch (...)
+    {
+        read_error = std::current_exception();
+    }
+
+    for (size_t i = 0; i < _options.parse_workers; i++)
+        parse_queue.push({0, {}, true});
+    for (auto& thread : threads)
+        thread.join();
+    writer.join();
+
+    if (read_error)
+        std::rethrow_exception(read_error);
+    if (write_error)
+        std::rethrow_exception(write_error);
+
+    pipeline_stats stats{};
+    stats.wall_seconds = std::chrono::duration<double>(clock::now() - start).count();
+    for (size_t i = 0; i < counters.size(); i++)
+    {
+        const uint64_t items = counters[i].items.load();
+        stats.stages[i] = {
+            .items = items,
+            .busy_seconds = static_cast<double>(counters[i].busy_ns.load()) / 1e9,
+            .items_per_second = stats.wall_seconds > 0 ? static_cast<double>(items) / stats.wall_seconds : 0,
+            .max_queue_depth = counters[i].max_queue_depth.load()
+        };
+    }
+    return stats;
+}
@@ -0,0 +1,76 @@
+#ifndef TC_PIPELINE_H
+#define TC_PIPELINE_H
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+#include "tc_evaluator.h"
+#include "tc_number.h"
+
+namespace tcalc
+{
+    struct pipeline_options
+    {
+        size_t parse_workers = 1;
+        size_t eval_workers = 1;
+        size_t queue_capacity = 1024;
+        bool comma_arg_separator = true;
+        int digits = 0;
+        number_format format = number_format::normal;
+    };
+
+    enum class pipeline_stage
+    {
+        read,
+        parse,
+        evaluate,
+        format,
+        write
+    };
+
+    std::string_view pipeline_stage_name(pipeline_stage stage);
+
+    struct pipeline_stage_stats
+    {
+        uint64_t items;
+        double busy_seconds; // Summed over the stage's workers, excluding time spent waiting on queues
+        double items_per_second; // Over the whole run
+        size_t max_queue_depth; // Of the queue feeding the stage; zero for the read stage
+    };
+
+    struct pipeline_stats
+    {
+        double wall_seconds;
+        std::array<pipeline_stage_stats, 5> stages; // Indexed by pipeline_stage
+
+        [[nodiscard]]
+        const pipeline_stage_stats& operator[](const pipeline_stage stage) const
+        {
+            return stages[static_cast<size_t>(stage)];
+        }
+    };
+
+    // Evaluates a stream of inputs on several threads: one reader, parse workers, evaluation workers that also format
+    // results, and one writer, connected by bounded lock-free queues. Each input is evaluated on its own by a copy of
+    // the prototype evaluator, so results are never committed and one input cannot see another's variables. Output is
+    // written in input order, one string per input: the results of its expressions joined by "; ", "error <name>", or
+    // nothing for a blank input.
+    class pipeline final
+    {
+    public:
+        pipeline(const evaluator& prototype, const pipeline_options& options);
+
+        // Calls read on the current thread until it returns false, and write on a writer thread in input order.
+        pipeline_stats run(const std::function<bool(std::string&)>& read,
+                           const std::function<void(std::string_view)>& write);
+
+    private:
+        const evaluator& _prototype;
+        pipeline_options _options;
+    };
+}
+
+#endif // TC_PIPELINE_H
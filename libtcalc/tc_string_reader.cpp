@@ -1,5 +1,7 @@
 #include "tc_string_reader.h"
 
+#include <algorithm>
+#include <cstring>
 #include <optional>
 
 #include "internal/utf8utils.h"
@@ -9,13 +11,20 @@ using namespace tcalc;
 std::pair<int, char32_t> string_reader::peek_with_length() const
 {
     if (_end_ix >= _string.length())
+    {
+        _read_extent = std::max(_read_extent, _string.length() + 1);
         return {0, end_of_file};
+    }
 
     const auto [length, character] = utf8utils::iterate_one_from_index(_string, _end_ix);
 
     if (length > 0)
+    {
+        _read_extent = std::max(_read_extent, _end_ix + length);
         return {length, character};
+    }
 
+    _read_extent = std::max(_read_extent, std::min(_string.length(), _end_ix + 4)); // Up to one full sequence
     return {0, 0};
 }
 
@@ -29,26 +38,25 @@ std::optional<char32_t> string_reader::peek() const
     return character;
 }
 
-std::u32string string_reader::peek_many(const int32_t count) const
+size_t string_reader::peek_many(const std::span<char32_t> out) const
 {
-    std::u32string out;
     auto index = _end_ix;
 
-    for (int32_t i = 0; i < count; i++)
+    for (size_t i = 0; i < out.size(); i++)
     {
         if (index >= _string.length())
-            return out;
+        {
+            _read_extent = std::max(_read_extent, _string.length() + 1);
+            return i;
+        }
 
         const auto [length, character] = utf8utils::iterate_one_from_index(_string, index);
 
-        out += character;
-
-        if (length > 0)
-            index += length;
-        else
-            index += length + 1;
+        out[i] = character;
+        _read_extent = std::max(_read_extent, length > 0 ? index + length : std::min(_string.length(), index + 4));
+        index += length > 0 ? length : 1; // Inch past invalid bytes, like forward() does
     }
-    return out;
+    return out.size();
 }
 
 std::optional<char32_t> string_reader::forward()
@@ -70,9 +78,60 @@ std::optional<char32_t> string_reader::forward()
     return _current;
 }
 
+namespace
+{
+    constexpr uint64_t repeat_byte(const uint8_t byte)
+    {
+        return 0x0101010101010101ull * byte;
+    }
+
+    // Whether all eight bytes are in '0'..'9': their high nibbles must be 3, and adding 6 must not carry out of any low
+    // nibble.
+    bool all_decimal_digits(const uint64_t word)
+    {
+        const uint64_t high_nibbles = repeat_byte(0xF0);
+        return (word & high_nibbles) == repeat_byte(0x30)
+            && ((word + repeat_byte(0x06)) & high_nibbles) == repeat_byte(0x30);
+    }
+}
+
+size_t string_reader::forward_digit_run()
+{
+    const char* data = _string.data();
+    const size_t length = _string.length();
+    size_t index = _end_ix;
+
+    while (true)
+    {
+        while (length - index >= sizeof(uint64_t))
+        {
+            uint64_t word;
+            std::memcpy(&word, data + index, sizeof word);
+            if (!all_decimal_digits(word))
+                break;
+            index += sizeof word;
+        }
+
+        const size_t before = index;
+        while (index < length && ((data[index] >= '0' && data[index] <= '9') || data[index] == '\''))
+            index++;
+        if (index == before || index == length)
+            break;
+    }
+
+    const size_t consumed = index - _end_ix;
+    if (consumed > 0)
+    {
+        _current = static_cast<char32_t>(data[index - 1]);
+        _end_ix = index;
+        _read_extent = std::max(_read_extent, index < length ? index + 1 : index);
+    }
+    return consumed;
+}
+
 std::pair<source_position, std::string_view> string_reader::flush()
 {
-    auto substr = std::string_view{_string}.substr(_start_ix, token_length());
+    auto substr = _string.substr(_start_ix, token_length());
     const source_position position{_start_ix, _end_ix};
     discard_token();
     return {position, substr};
@@ -2,7 +2,9 @@
 #define TC_STRING_READER_H
 
 #include <cstdint>
+#include <memory>
 #include <optional>
+#include <span>
 #include <string>
 #include <utility>
 
@@ -15,19 +17,42 @@ namespace tcalc
     class string_reader final
     {
     public:
-        explicit string_reader(std::string&& input) : _string{std::move(input)}
+        // The input is kept on the heap so that token views into it stay valid when the reader is moved.
+        explicit string_reader(std::string&& input) :
+            _owned{std::make_unique<const std::string>(std::move(input))},
+            _string{*_owned}
         {
         }
 
-        explicit string_reader(const std::string& input) : _string{input}
+        explicit string_reader(const std::string& input) :
+            _owned{std::make_unique<const std::string>(input)},
+            _string{*_owned}
         {
         }
 
+        // Reads the input in place without copying it. The caller must keep it alive for as long as the reader and any
+        // token viewing it.
+        static string_reader borrowing(const std::string_view input)
+        {
+            return string_reader{input};
+        }
+
+        // Starts reading a new borrowed input from the given byte index, as if freshly constructed by borrowing().
+        void reset(const std::string_view input, const size_t start_index = 0)
+        {
+            _current = std::nullopt;
+            _owned = nullptr;
+            _string = input;
+            _start_ix = start_index;
+            _end_ix = start_index;
+            _read_extent = start_index;
+        }
+
         [[nodiscard]]
         std::optional<char32_t> peek() const;
 
-        [[nodiscard]]
-        std::u32string peek_many(int32_t count) const;
+        // Fills out with the next characters without consuming them or allocating; returns how many were available.
+        size_t peek_many(std::span<char32_t> out) const;
 
         [[nodiscard]]
         std::optional<char32_t> current() const
@@ -37,6 +62,9 @@ namespace tcalc
 
         std::optional<char32_t> forward();
 
+        // Consumes a run of ASCII decimal digits and ' digit separators in bulk, returning how many bytes it consumed.
+        size_t forward_digit_run();
+
         void forward_many(const int32_t count)
         {
             for (int32_t i = 0; i < count; i++)
@@ -52,18 +80,31 @@ namespace tcalc
         [[nodiscard]]
         std::pair<source_position, std::string_view> flush();
 
+        // One past the highest byte index looked at so far. Looking at the end of the input counts as one byte past it.
+        [[nodiscard]]
+        size_t read_extent() const
+        {
+            return _read_extent;
+        }
+
         void discard_token()
         {
             _start_ix = _end_ix;
         }
 
     private:
+        explicit string_reader(const std::string_view input) : _string{input}
+        {
+        }
+
         [[nodiscard]]
         std::pair<int, char32_t> peek_with_length() const;
         std::optional<char32_t> _current;
-        std::string _string;
+        std::unique_ptr<const std::string> _owned;
+        std::string_view _string;
         size_t _start_ix = 0;
         size_t _end_ix = 0;
+        mutable size_t _read_extent = 0;
     };
 }
 
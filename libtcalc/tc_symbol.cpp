@@ -0,0 +1,85 @@
+#include "tc_symbol.h"
+
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+#include "internal/library_names.h"
+
+using namespace tcalc;
+
+namespace
+{
+    // Shared by every parser and evaluator so that expressions can be evaluated by any evaluator, on any thread.
+    class interner final
+    {
+    public:
+        static interner& instance()
+        {
+            static interner inst;
+            return inst;
+        }
+
+        interner()
+        {
+            for (const std::string_view name : symbol_detail::library_names())
+                intern(name, false);
+        }
+
+        // Returns the id of name, interning it if it is new and either bounded is false or the limits allow it.
+        std::optional<symbol::id_type> intern(const std::string_view name, const bool bounded)
+        {
+            {
+                std::shared_lock lock{_mutex};
+                if (const auto it = _ids.find(name); it != _ids.end())
+                    return it->second;
+            }
+
+            std::unique_lock lock{_mutex};
+            if (const auto it = _ids.find(name); it != _ids.end())
+                return it->second;
+
+            if (bounded && (_names.size() >= symbol::max_interned_names ||
+                            _bytes + name.size() > symbol::max_interned_bytes))
+                return std::nullopt;
+
+            const auto id = static_cast<symbol::id_type>(_names.size());
+            const std::string& stored = _names.emplace_back(name); // deque elements never move
+            _ids.emplace(stored, id);
+            _bytes += name.size();
+            return id;
+        }
+
+        std::string_view name(const symbol::id_type id)
+        {
+            std::shared_lock lock{_mutex};
+            return _names[id];
+        }
+
+    private:
+        std::shared_mutex _mutex;
+        std::deque<std::string> _names;
+        std::unordered_map<std::string_view, symbol::id_type> _ids;
+        size_t _bytes = 0;
+    };
+}
+
+symbol::symbol(const std::string_view name) : _id{*interner::instance().intern(name, false)}
+{
+}
+
+std::optional<symbol> symbol::try_intern(const std::string_view name)
+{
+    const auto id = interner::instance().intern(name, true);
+    if (!id)
+        return std::nullopt;
+    return from_id(*id);
+}
+
+std::string_view symbol::name() const
+{
+    return interner::instance().name(_id);
+}
@@ -0,0 +1,123 @@
+#ifndef TC_SYMBOL_H
+#define TC_SYMBOL_H
+
+#include <algorithm>
+#include <compare>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace tcalc
+{
+    // An interned identifier. Every distinct name is given a small id once, for the lifetime of the process, so symbols
+    // are compared and looked up as integers; the name is only needed for diagnostics and display.
+    class symbol final
+    {
+    public:
+        using id_type = uint32_t;
+
+        // Names are interned for the lifetime of the process, so names from untrusted input go through try_intern
+        // instead, which stops at these limits. This constructor always interns; it is meant for names from code.
+        static constexpr size_t max_interned_names = size_t{1} << 20;
+        static constexpr size_t max_interned_bytes = size_t{64} << 20;
+
+        explicit symbol(std::string_view name);
+
+        // The symbol for name, or nothing if name is new and the interner has reached its limits.
+        [[nodiscard]]
+        static std::optional<symbol> try_intern(std::string_view name);
+
+        // The symbol with an id previously returned by id().
+        [[nodiscard]]
+        static symbol from_id(const id_type id)
+        {
+            symbol sym;
+            sym._id = id;
+            return sym;
+        }
+
+        [[nodiscard]]
+        id_type id() const
+        {
+            return _id;
+        }
+
+        [[nodiscard]]
+        std::string_view name() const;
+
+        bool operator==(const symbol&) const = default;
+        std::strong_ordering operator<=>(const symbol&) const = default;
+
+    private:
+        symbol() = default;
+
+        id_type _id{};
+    };
+
+    // A map from symbols to values, hashed by symbol id. Ids cover every name the process has interned, so the table
+    // only stores the symbols it holds.
+    template<class T>
+    class symbol_table final
+    {
+    public:
+        [[nodiscard]]
+        const T* find(const symbol sym) const
+        {
+            const auto it = _entries.find(sym.id());
+            return it == _entries.end() ? nullptr : &it->second;
+        }
+
+        [[nodiscard]]
+        T* find(const symbol sym)
+        {
+            return const_cast<T*>(std::as_const(*this).find(sym));
+        }
+
+        [[nodiscard]]
+        bool contains(const symbol sym) const
+        {
+            return _entries.contains(sym.id());
+        }
+
+        void insert_or_assign(const symbol sym, T value)
+        {
+            _entries.insert_or_assign(sym.id(), std::move(value));
+        }
+
+        // Calls fn(symbol, value) for every entry, in order of symbol id.
+        template<class Fn>
+        void for_each(Fn&& fn) const
+        {
+            std::vector<const std::pair<const symbol::id_type, T>*> sorted;
+            sorted.reserve(_entries.size());
+            for (const auto& entry : _entries)
+                sorted.push_back(&entry);
+            std::ranges::sort(sorted, {}, [](const auto* entry) { return entry->first; });
+
+            for (const auto* entry : sorted)
+                fn(symbol::from_id(entry->first), entry->second);
+        }
+
+        void clear()
+        {
+            _entries.clear();
+        }
+
+    private:
+        std::unordered_map<symbol::id_type, T> _entries;
+    };
+}
+
+template<>
+struct std::hash<tcalc::symbol>
+{
+    size_t operator()(const tcalc::symbol sym) const noexcept
+    {
+        return sym.id();
+    }
+};
+
+#endif // TC_SYMBOL_H
@@ -1,8 +1,8 @@
 #ifndef TC_TOKEN_H
 #define TC_TOKEN_H
 
-#include <memory>
 #include <string>
+#include <string_view>
 
 #include "tc_source_position.h"
 
@@ -62,8 +62,9 @@ namespace tcalc
     class token final
     {
     public:
-        token(const token_kind kind, std::string&& str, const source_position pos) :
-            _source{std::move(str)},
+        // A token only views its text, which is owned by the lexer's string_reader and must outlive the token.
+        token(const token_kind kind, const std::string_view str, const source_position pos) :
+            _source{str},
             _position{pos},
             _kind{kind}
         {
@@ -102,7 +103,7 @@ namespace tcalc
             return _position.end_index;
         }
     private:
-        std::string _source;
+        std::string_view _source;
         source_position _position;
         token_kind _kind;
     };
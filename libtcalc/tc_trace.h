@@ -0,0 +1,27 @@
+#ifndef TC_TRACE_H
+#define TC_TRACE_H
+
+#include <cstddef>
+#include <iosfwd>
+
+namespace tcalc
+{
+    // Starts recording spans of lexing, parsing, evaluation, builtin calls and number formatting on every thread.
+    // Each thread records into its own ring buffer holding the given number of spans, overwriting its oldest spans
+    // once full. When a thread exits, the next thread to record takes its buffer over, so there are only as many
+    // buffers as threads recording at once. Starting again discards what was recorded before, and must not race with
+    // traced work.
+    void start_tracing(size_t spans_per_thread = 65536);
+
+    void stop_tracing();
+
+    [[nodiscard]]
+    bool tracing();
+
+    // Writes the recorded spans as Chrome trace event JSON, which chrome://tracing and Perfetto open. Must not race
+    // with traced work. Lexing is recorded in batches of consecutive tokens, whose duration is the time spent lexing
+    // them rather than the time between the first and the last.
+    void write_trace(std::ostream& out);
+}
+
+#endif // TC_TRACE_H
@@ -0,0 +1,522 @@
+#include "accuracy.h"
+
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <format>
+#include <iostream>
+#include <limits>
+#include <numbers>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "report.h"
+#include "tc_evaluator.h"
+#include "tc_lexer.h"
+#include "tc_parser.h"
+
+namespace
+{
+    using clock = std::chrono::steady_clock;
+
+    // Where random inputs are drawn from and which adversarial inputs are kept. Inputs outside a function's real
+    // domain are skipped anyway; the domains only keep most of them useful.
+    enum class domain
+    {
+        any,
+        positive,
+        unit, // [-1, 1]
+        outside_unit, // |x| >= 1
+        at_least_one,
+        exp_range // Where exp, sinh and cosh stay finite in double
+    };
+
+    struct function_case
+    {
+        std::string_view name;
+        domain inputs;
+        double (*double_fn)(double);
+        long double (*long_double_fn)(long double);
+    };
+
+    // The same expression in double and in long double. The reciprocal forms are composed the way the builtins compose
+    // them, so that both sides compute the same function.
+#define LIBM_CASE(name, inputs, expr) \
+    function_case{name, inputs, [](const double x) { return expr; }, [](const long double x) { return expr; }}
+
+    const function_case functions[] =
+    {
+        LIBM_CASE("sqrt", domain::positive, std::sqrt(x)),
+        LIBM_CASE("cbrt", domain::positive, std::cbrt(x)),
+        LIBM_CASE("exp", domain::exp_range, std::exp(x)),
+        LIBM_CASE("log", domain::positive, std::log10(x)),
+        LIBM_CASE("ln", domain::positive, std::log(x)),
+        LIBM_CASE("sin", domain::any, std::sin(x)),
+        LIBM_CASE("cos", domain::any, std::cos(x)),
+        LIBM_CASE("tan", domain::any, std::tan(x)),
+        LIBM_CASE("sec", domain::any, 1 / std::cos(x)),
+        LIBM_CASE("csc", domain::any, 1 / std::sin(x)),
+        LIBM_CASE("cot", domain::any, 1 / std::tan(x)),
+        LIBM_CASE("asin", domain::unit, std::asin(x)),
+        LIBM_CASE("acos", domain::unit, std::acos(x)),
+        LIBM_CASE("atan", domain::any, std::atan(x)),
+        LIBM_CASE("asec", domain::outside_unit, std::acos(1 / x)),
+        LIBM_CASE("acsc", domain::outside_unit, std::asin(1 / x)),
+        LIBM_CASE("acot", domain::any, std::atan(1 / x)),
+        LIBM_CASE("sinh", domain::exp_range, std::sinh(x)),
+        LIBM_CASE("cosh", domain::exp_range, std::cosh(x)),
+        LIBM_CASE("tanh", domain::any, std::tanh(x)),
+        LIBM_CASE("sech", domain::exp_range, 1 / std::cosh(x)),
+        LIBM_CASE("csch", domain::exp_range, 1 / std::sinh(x)),
+        LIBM_CASE("coth", domain::any, 1 / std::tanh(x)),
+        LIBM_CASE("asinh", domain::any, std::asinh(x)),
+        LIBM_CASE("acosh", domain::at_least_one, std::acosh(x)),
+        LIBM_CASE("atanh", domain::unit, std::atanh(x)),
+        LIBM_CASE("asech", domain::unit, std::acosh(1 / x)),
+        LIBM_CASE("acsch", domain::any, std::asinh(1 / x)),
+        LIBM_CASE("acoth", domain::outside_unit, std::atanh(1 / x)),
+    };
+
+#undef LIBM_CASE
+
+    struct accuracy_options
+    {
+        long samples = 2000;
+        uint64_t seed = 1;
+        long precision = 53;
+        long reference_bits = 256;
+        int repeats = 3;
+        double slow_factor = 4;
+        double max_ulp = -1; // Gates are off when negative
+        double max_slowdown = -1;
+        std::vector<std::string> only;
+    };
+
+    constexpr std::array<double, 6> histogram_bounds = {0.5, 1, 2, 4, 16, 256};
+
+    // Errors of one implementation of one function, in ulps of the precision it works in.
+    struct error_stats
+    {
+        uint64_t compared = 0;
+        uint64_t wrong = 0; // Evaluation errors, NaNs and infinities where the true result is finite
+        std::array<uint64_t, histogram_bounds.size() + 1> histogram{};
+        std::vector<double> ulps;
+        double max = 0;
+        double worst_input = 0;
+        double first_wrong_input = 0;
+
+        void add(const double input, const double error)
+        {
+            compared++;
+            ulps.push_back(error);
+            histogram[std::ranges::lower_bound(histogram_bounds, error) - histogram_bounds.begin()]++;
+            if (error > max)
+            {
+                max = error;
+                worst_input = input;
+            }
+        }
+
+        void add_wrong(const double input)
+        {
+            if (wrong == 0)
+                first_wrong_input = input;
+            compared++;
+            wrong++;
+        }
+    };
+
+    struct function_report
+    {
+        std::string_view name;
+        uint64_t inputs = 0;
+        uint64_t skipped = 0; // Outside the real domain, or with a true result beyond long double
+        error_stats tcalc;
+        error_stats double_libm;
+        error_stats long_double_libm;
+        double tcalc_ns = 0;
+        double overhead_ns = 0; // Setting x and evaluating `x`, which tcalc_ns excludes
+        double double_ns = 0;
+        double long_double_ns = 0;
+
+        [[nodiscard]]
+        double slowdown() const
+        {
+            return double_ns > 0 ? tcalc_ns / double_ns : 0;
+        }
+    };
+
+    volatile double double_sink;
+    volatile long double long_double_sink;
+
+    bool in_domain(const domain d, const double x)
+    {
+        switch (d)
+        {
+            case domain::any:
+                return true;
+            case domain::positive:
+                return x > 0;
+            case domain::unit:
+                return std::abs(x) <= 1;
+            case domain::outside_unit:
+                return std::abs(x) >= 1;
+            case domain::at_least_one:
+                return x >= 1;
+            case domain::exp_range:
+                return std::abs(x) <= 746;
+        }
+        return false;
+    }
+
+    // Inputs where libm implementations are known to lose accuracy: the edges of the domains, both ends of the
+    // exponent range, the neighbours of multiples of pi/2, and huge arguments that need many bits of pi to reduce,
+    // ending with the hardest known case for sin and cos. Each is taken with its sign flipped and its neighbours.
+    std::vector<double> adversarial_inputs(const domain d)
+    {
+        std::vector<double> candidates = {0.0, 0.5, 1.0, 2.0, DBL_MIN, DBL_MAX,
+                                          std::numeric_limits<double>::denorm_min(), 709.782712893384,
+                                          710.4758600739439, 745.1332191019411, 0x1.6ac5b262ca1ffp+849};
+        for (int k = 1; k <= 1074; k += 7)
+            candidates.push_back(std::ldexp(1.0, -k));
+        for (int k = 1; k <= 1023; k += 7)
+            candidates.push_back(std::ldexp(1.0, k));
+        for (int k = 1; k <= 53; k++)
+        {
+            candidates.push_back(1 + std::ldexp(1.0, -k));
+            candidates.push_back(1 - std::ldexp(1.0, -k));
+        }
+        for (int k = 1; k <= 256; k++)
+            candidates.push_back(static_cast<double>(k * std::numbers::pi_v<long double> / 2));
+        for (int k = 8; k <= 1016; k += 12)
+            candidates.push_back(std::ldexp(std::numbers::pi, k));
+
+        std::vector<double> inputs;
+        for (const double candidate : candidates)
+        {
+            for (const double x : {candidate, -candidate})
+            {
+                for (const double input : {x, std::nextafter(x, -INFINITY), std::nextafter(x, INFINITY)})
+                {
+                    if (std::isfinite(input) && in_domain(d, input))
+                        inputs.push_back(input);
+                }
+            }
+        }
+        std::ranges::sort(inputs);
+        inputs.erase(std::ranges::unique(inputs).begin(), inputs.end());
+        return inputs;
+    }
+
+    // Log-uniform magnitudes, so that every binade from 2^-30 to 2^30 is sampled about equally.
+    double random_input(std::mt19937_64& rng, const domain d)
+    {
+        std::uniform_real_distribution<double> fraction{1, 2};
+        const auto magnitude = [&](const int lo, const int hi)
+        {
+            return std::ldexp(fraction(rng), std::uniform_int_distribution<int>{lo, hi}(rng));
+        };
+        const double sign = (rng() & 1) != 0 ? -1 : 1;
+
+        switch (d)
+        {
+            case domain::any:
+                return sign * magnitude(-30, 30);
+            case domain::positive:
+                return magnitude(-30, 30);
+            case domain::unit:
+                return sign * magnitude(-30, -1);
+            case domain::outside_unit:
+                return sign * (1 + magnitude(-30, 30));
+            case domain::at_least_one:
+                return 1 + magnitude(-30, 30);
+            case domain::exp_range:
+                return sign * std::min(magnitude(-30, 9), 709.0);
+        }
+        return 0;
+    }
+
+    // |y - truth| in units in the last place of a significand of the given bits at the magnitude of truth, or at the
+    // smallest normal magnitude of a format with the given minimum exponent, below which ulps no longer shrink. Both
+    // must be finite. Worked out in tcalc numbers, as the ulps of wide significands underflow long double.
+    double ulp_error(const tcalc::number& y, const tcalc::number& truth, const int bits, const int min_exponent)
+    {
+        tcalc::number error{truth.precision()};
+        error.sub(y, truth);
+        if (error == 0)
+            return 0;
+        error.abs(error);
+
+        // An ulp at exponent e (truth = m * 2^e, 1/2 <= |m| < 1) is 2^(e - bits)
+        const long exponent = truth == 0 ? min_exponent : std::max(truth.real_exponent(), long{min_exponent});
+        error.mul_2exp(error, bits - exponent);
+        return error.real_double();
+    }
+
+    // Real mode and radians, the setting libm computes in.
+    tcalc::evaluator make_evaluator(const long precision)
+    {
+        tcalc::evaluator evaluator{precision};
+        evaluator.complex_mode(false);
+        evaluator.trig_unit(tcalc::angle_unit::radians);
+        return evaluator;
+    }
+
+    tcalc::arithmetic_expression parse_arithmetic(const std::string& source, const long precision)
+    {
+        tcalc::parser parser{tcalc::lexer{std::string{source}, true}, precision};
+        return std::get<tcalc::arithmetic_expression>(parser.parse_expression());
+    }
+
+    tcalc::evaluator::result_type assignment(const tcalc::symbol variable, const double x, const long precision)
+    {
+        tcalc::number value{precision};
+        value.set_double(x);
+        return tcalc::assign_result{variable, std::move(value)};
+    }
+
+    template<class Fn>
+    double best_ns_per_input(const size_t inputs, const int repeats, Fn&& fn)
+    {
+        double best = std::numeric_limits<double>::infinity();
+        for (int i = 0; i < repeats; i++)
+        {
+            const auto start = clock::now();
+            fn();
+            best = std::min(best, std::chrono::duration<double, std::nano>(clock::now() - start).count());
+        }
+        return inputs > 0 ? best / static_cast<double>(inputs) : 0;
+    }
+
+    // The true result of each input comes from the same builtin at the reference precision, which is far beyond what
+    // rounding to double or long double can resolve. tcalc is timed through the evaluator, as users call it, less the
+    // cost of setting x and evaluating a bare `x`.
+    function_report run_function(const function_case& fn, const uint64_t seed, const accuracy_options& options)
+    {
+        function_report report;
+        report.name = fn.name;
+        std::mt19937_64 rng{seed};
+        std::vector<double> inputs = adversarial_inputs(fn.inputs);
+        for (long i = 0; i < options.samples; i++)
+            inputs.push_back(random_input(rng, fn.inputs));
+
+        const tcalc::symbol x{"x"};
+        const std::string call = std::format("{}(x)", fn.name);
+        tcalc::evaluator reference = make_evaluator(options.reference_bits);
+        tcalc::evaluator tested = make_evaluator(options.precision);
+        const auto reference_call = parse_arithmetic(call, options.reference_bits);
+        const auto tested_call = parse_arithmetic(call, options.precision);
+
+        std::vector<double> valid;
+        std::vector<tcalc::evaluator::result_type> assignments;
+        tcalc::number y{options.reference_bits};
+        for (const double input : inputs)
+        {
+            reference.commit_result(assignment(x, input, options.reference_bits));
+            const auto truth = reference.evaluate_arithmetic(reference_call);
+            if (truth.is_error() || !std::isfinite(truth.value().real_long_double()))
+            {
+                report.skipped++;
+                continue;
+            }
+            const tcalc::number& t = truth.value();
+            report.inputs++;
+            valid.push_back(input);
+
+            assignments.push_back(assignment(x, input, options.precision));
+            tested.commit_result(assignments.back());
+            const auto result = tested.evaluate_arithmetic(tested_call);
+            if (result.is_error() || result.value().is_nan() || result.value().is_infinity())
+                report.tcalc.add_wrong(input);
+            else
+                report.tcalc.add(input, ulp_error(result.value(), t, options.precision, LDBL_MIN_EXP));
+
+            if (std::isfinite(t.real_double()))
+            {
+                const double d = fn.double_fn(input);
+                y.set_double(d);
+                if (std::isfinite(d))
+                    report.double_libm.add(input, ulp_error(y, t, DBL_MANT_DIG, DBL_MIN_EXP));
+                else
+                    report.double_libm.add_wrong(input);
+            }
+
+            const long double ld = fn.long_double_fn(input);
+            y.set_long_double(ld);
+            if (std::isfinite(ld))
+                report.long_double_libm.add(input, ulp_error(y, t, LDBL_MANT_DIG, LDBL_MIN_EXP));
+            else
+                report.long_double_libm.add_wrong(input);
+        }
+
+        const auto time_tcalc = [&](const tcalc::arithmetic_expression& expr)
+        {
+            return best_ns_per_input(assignments.size(), options.repeats, [&]
+            {
+                for (const auto& a : assignments)
+                {
+                    tested.commit_result(a);
+                    (void)tested.evaluate_arithmetic(expr);
+                }
+            });
+        };
+        report.overhead_ns = time_tcalc(parse_arithmetic("x", options.precision));
+        report.tcalc_ns = std::max(0.0, time_tcalc(tested_call) - report.overhead_ns);
+
+        report.double_ns = best_ns_per_input(valid.size(), options.repeats, [&]
+        {
+            double sum = 0;
+            for (const double input : valid)
+                sum += fn.double_fn(input);
+            double_sink = sum;
+        });
+        report.long_double_ns = best_ns_per_input(valid.size(), options.repeats, [&]
+        {
+            long double sum = 0;
+            for (const double input : valid)
+                sum += fn.long_double_fn(input);
+            long_double_sink = sum;
+        });
+        return report;
+    }
+
+    // C99 hexadecimal floating point, which reads back exactly
+    std::string hex_float(const double x)
+    {
+        return std::format("\"{}0x{:a}\"", std::signbit(x) ? "-" : "", std::abs(x));
+    }
+
+    void write_errors(std::ostream& out, error_stats& stats)
+    {
+        std::ranges::sort(stats.ulps);
+        double sum = 0;
+        for (const double ulps : stats.ulps)
+            sum += ulps;
+
+        const double mean = stats.ulps.empty() ? 0 : sum / static_cast<double>(stats.ulps.size());
+        out << std::format(R"({{"compared": {}, "wrong": {}, "max_ulp": {:.4g}, "mean_ulp": {:.4g}, )", stats.compared,
+                           stats.wrong, stats.max, mean)
+            << std::format(R"("p50_ulp": {:.4g}, "p99_ulp": {:.4g}, "worst_input": {}, )", percentile(stats.ulps, 0.5),
+                           percentile(stats.ulps, 0.99), hex_float(stats.worst_input));
+        if (stats.wrong > 0)
+            out << std::format(R"("first_wrong_input": {}, )", hex_float(stats.first_wrong_input));
+
+        out << "\"histogram\": {";
+        for (size_t i = 0; i < stats.histogram.size(); i++)
+        {
+            const double bound = histogram_bounds[std::min(i, histogram_bounds.size() - 1)];
+            out << std::format(R"({}"{}{}": {})", i == 0 ? "" : ", ", i < histogram_bounds.size() ? "<=" : ">", bound,
+                               stats.histogram[i]);
+        }
+        out << "}}";
+    }
+
+    bool parse_options(const int argc, char* argv[], accuracy_options& options)
+    {
+        for (int i = 2; i < argc; i++)
+        {
+            const std::string_view arg = argv[i];
+            if (i + 1 >= argc)
+                return false;
+            if (arg == "--samples")
+                options.samples = std::atol(argv[++i]);
+            else if (arg == "--seed")
+                options.seed = std::strtoull(argv[++i], nullptr, 10);
+            else if (arg == "--precision")
+                options.precision = std::atol(argv[++i]);
+            else if (arg == "--reference-bits")
+                options.reference_bits = std::atol(argv[++i]);
+            else if (arg == "--repeats")
+                options.repeats = std::atoi(argv[++i]);
+            else if (arg == "--slow-factor")
+                options.slow_factor = std::atof(argv[++i]);
+            else if (arg == "--max-ulp")
+                options.max_ulp = std::atof(argv[++i]);
+            else if (arg == "--max-slowdown")
+                options.max_slowdown = std::atof(argv[++i]);
+            else if (arg == "--only")
+            {
+                std::istringstream names{argv[++i]};
+                for (std::string name; std::getline(names, name, ',');)
+                    options.only.push_back(name);
+            }
+            else
+                return false;
+        }
+
+        // Inputs are doubles, which must reach tcalc unrounded
+        return options.samples >= 0 && options.precision >= DBL_MANT_DIG
+            && options.reference_bits >= options.precision + 64 && options.repeats > 0;
+    }
+}
+
+int accuracy(const int argc, char* argv[])
+{
+    accuracy_options options;
+    if (!parse_options(argc, argv, options))
+    {
+        std::cerr << "usage: tcalc accuracy [--samples N] [--seed S] [--precision N] [--reference-bits N]"
+            " [--repeats K] [--only name,...] [--slow-factor F] [--max-ulp U] [--max-slowdown R]\n";
+        return 2;
+    }
+
+    std::vector<function_report> reports;
+    for (size_t i = 0; i < std::size(functions); i++)
+    {
+        const auto& fn = functions[i];
+        if (options.only.empty() || std::ranges::find(options.only, fn.name) != options.only.end())
+            reports.push_back(run_function(fn, options.seed + i, options));
+    }
+    if (reports.empty())
+    {
+        std::cerr << "tcalc: no function matches --only\n";
+        return 2;
+    }
+
+    // A function is slow when its slowdown against double libm is far above the typical one, which is the cost of
+    // arbitrary precision itself rather than of the function's own algorithm.
+    std::vector<double> slowdowns;
+    for (const auto& report : reports)
+        slowdowns.push_back(report.slowdown());
+    std::ranges::sort(slowdowns);
+    const double median_slowdown = percentile(slowdowns, 0.5);
+
+    std::vector<std::string> failures;
+    std::cout << std::format(R"({{"precision": {}, "reference_bits": {}, "samples": {}, "seed": {}, )",
+                             options.precision, options.reference_bits, options.samples, options.seed)
+        << std::format(R"("median_slowdown": {:.4g}, "functions": [)", median_slowdown);
+    for (size_t i = 0; i < reports.size(); i++)
+    {
+        auto& report = reports[i];
+        const bool slow = report.slowdown() > options.slow_factor * median_slowdown;
+        std::cout << (i == 0 ? "\n  " : ",\n  ")
+            << std::format(R"({{"name": {}, "inputs": {}, "skipped": {}, "tcalc": )", json_string(report.name),
+                           report.inputs, report.skipped);
+        write_errors(std::cout, report.tcalc);
+        std::cout << ", \"double\": ";
+        write_errors(std::cout, report.double_libm);
+        std::cout << ", \"long_double\": ";
+        write_errors(std::cout, report.long_double_libm);
+        std::cout << std::format(R"(, "tcalc_ns": {:.4g}, "evaluator_overhead_ns": {:.4g}, "double_ns": {:.4g}, )",
+                                 report.tcalc_ns, report.overhead_ns, report.double_ns)
+            << std::format(R"("long_double_ns": {:.4g}, "slowdown": {:.4g}, "slow": {}}})", report.long_double_ns,
+                           report.slowdown(), slow);
+
+        if (options.max_ulp >= 0 && (report.tcalc.max > options.max_ulp || report.tcalc.wrong > 0))
+            failures.push_back(std::format("{}: max {:.4g} ulp, {} wrong", report.name, report.tcalc.max,
+                                           report.tcalc.wrong));
+        if (options.max_slowdown >= 0 && report.slowdown() > options.max_slowdown)
+            failures.push_back(std::format("{}: {:.4g} times slower than double", report.name, report.slowdown()));
+    }
+
+    std::cout << std::format("\n], \"gate\": {{\"passed\": {}, \"failures\": [", failures.empty());
+    for (size_t i = 0; i < failures.size(); i++)
+        std::cout << (i == 0 ? "" : ", ") << json_string(failures[i]);
+    std::cout << "]}}\n";
+    return failures.empty() ? 0 : 1;
+}
@@ -0,0 +1,9 @@
+#ifndef TCALC_ACCURACY_H
+#define TCALC_ACCURACY_H
+
+// Evaluates the real builtins on random and adversarial inputs through tcalc and through double and long double libm,
+// and reports the ulp error distributions and the speed of each as JSON. Exits with 1 when a --max-ulp or
+// --max-slowdown gate fails.
+int accuracy(int argc, char* argv[]);
+
+#endif // TCALC_ACCURACY_H
@@ -0,0 +1,461 @@
+#include "batch.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "tc_evaluator.h"
+#include "tc_lexer.h"
+#include "tc_parse_cache.h"
+#include "tc_parser.h"
+#include "tc_pipeline.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    constexpr std::size_t block_size = 1 << 20;
+
+    struct batch_options
+    {
+        long precision = 64;
+        int digits = 0;
+        tcalc::number_format format = tcalc::number_format::normal;
+        bool comma_arg_separator = true;
+        size_t parse_cache_size = 0;
+        size_t jobs = 1;
+        const char* path = nullptr;
+    };
+
+    // Read-only view of a whole file. Empty files map to an empty view.
+    class mapped_file final
+    {
+    public:
+        explicit mapped_file(const char* path)
+        {
+#ifdef _WIN32
+            _file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN,
+                                nullptr);
+            if (_file == INVALID_HANDLE_VALUE)
+                return;
+            LARGE_INTEGER size;
+            if (!GetFileSizeEx(_file, &size))
+                return;
+            _good = true;
+            if (size.QuadPart == 0)
+                return;
+            _mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (_mapping == nullptr)
+            {
+                _good = false;
+                return;
+            }
+            _data = static_cast<const char*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+            _size = static_cast<std::size_t>(size.QuadPart);
+            _good = _data != nullptr;
+#else
+            _fd = open(path, O_RDONLY);
+            if (_fd < 0)
+                return;
+            struct stat st{};
+            if (fstat(_fd, &st) != 0)
+                return;
+            _good = true;
+            if (st.st_size == 0)
+                return;
+            void* data = mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, _fd, 0);
+            if (data == MAP_FAILED)
+            {
+                _good = false;
+                return;
+            }
+            madvise(data, static_cast<std::size_t>(st.st_size), MADV_SEQUENTIAL);
+            _data = static_cast<const char*>(data);
+            _size = static_cast<std::size_t>(st.st_size);
+#endif
+        }
+
+        mapped_file(const mapped_file&) = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+
+        ~mapped_file()
+        {
+#ifdef _WIN32
+            if (_data != nullptr)
+                UnmapViewOfFile(_data);
+            if (_mapping != nullptr)
+                CloseHandle(_mapping);
+            if (_file != INVALID_HANDLE_VALUE)
+                CloseHandle(_file);
+#else
+            if (_data != nullptr)
+                munmap(const_cast<char*>(_data), _size);
+            if (_fd >= 0)
+                close(_fd);
+#endif
+        }
+
+        [[nodiscard]]
+        bool good() const
+        {
+            return _good;
+        }
+
+        [[nodiscard]]
+        std::string_view view() const
+        {
+            return {_data, _size};
+        }
+
+    private:
+#ifdef _WIN32
+        HANDLE _file = INVALID_HANDLE_VALUE;
+        HANDLE _mapping = nullptr;
+#else
+        int _fd = -1;
+#endif
+        const char* _data = nullptr;
+        std::size_t _size = 0;
+        bool _good = false;
+    };
+
+    class buffered_writer final
+    {
+    public:
+        explicit buffered_writer(std::FILE* out) : _out{out}
+        {
+            _buffer.reserve(block_size);
+        }
+
+        buffered_writer(const buffered_writer&) = delete;
+        buffered_writer& operator=(const buffered_writer&) = delete;
+
+        ~buffered_writer()
+        {
+            flush();
+        }
+
+        void write(const std::string_view str)
+        {
+            _buffer.append(str);
+            if (_buffer.size() >= block_size)
+                flush();
+        }
+
+        void put(const char c)
+        {
+            _buffer.push_back(c);
+        }
+
+        void flush()
+        {
+            std::fwrite(_buffer.data(), 1, _buffer.size(), _out);
+            _buffer.clear();
+        }
+
+    private:
+        std::FILE* _out;
+        std::string _buffer;
+    };
+
+    class batch_runner final
+    {
+    public:
+        batch_runner(const batch_options& options, buffered_writer& out) :
+            _options{options},
+            _evaluator{options.precision},
+            _parser{tcalc::lexer::borrowing({}, options.comma_arg_separator), options.precision},
+            _out{out}
+        {
+            if (options.parse_cache_size > 0)
+                _cache = std::make_unique<tcalc::parse_cache>(options.parse_cache_size);
+        }
+
+        // Evaluates every line of the buffer, which must hold only whole lines. The lexer reads the buffer in place.
+        void process(std::string_view buffer)
+        {
+            while (!buffer.empty())
+            {
+                const std::size_t newline = buffer.find('\n');
+                std::string_view line = buffer.substr(0, newline);
+                buffer.remove_prefix(newline == std::string_view::npos ? buffer.size() : newline + 1);
+
+                if (!line.empty() && line.back() == '\r')
+                    line.remove_suffix(1);
+                process_line(line);
+                _out.put('\n');
+            }
+        }
+
+    private:
+        void process_line(const std::string_view line)
+        {
+            if (line.find_first_not_of(" \t") == std::string_view::npos)
+                return;
+
+            const std::vector<tcalc::expression>* expressions = &_expressions;
+            const std::vector<tcalc::diagnostic>* diagnostics = &_parser.diagnostic_bag();
+            std::shared_ptr<const tcalc::parse_result> cached;
+            if (_cache != nullptr)
+            {
+                cached = _cache->parse(line, _options.comma_arg_separator, _options.precision);
+                expressions = &cached->expressions;
+                diagnostics = &cached->diagnostics;
+            }
+            else
+            {
+                _parser.reset(line);
+                _parser.parse_all(_expressions);
+            }
+
+            if (!diagnostics->empty())
+            {
+                _out.write("error ");
+                _out.write(tcalc::diagnostic_type_name(diagnostics->front().type()));
+                return;
+            }
+
+            bool first = true;
+            for (const auto& expr : *expressions)
+            {
+                if (!first)
+                    _out.write("; ");
+                first = false;
+
+                auto res = _evaluator.evaluate(expr);
+                if (res.is_error())
+                {
+                    _out.write("error ");
+                    _out.write(tcalc::eval_error_type_name(res.error().type));
+                    return;
+                }
+
+                write_result(res.value());
+                _evaluator.commit_result(res.value());
+            }
+        }
+
+        void write_result(const tcalc::evaluator::result_type& result)
+        {
+            if (const auto* num = std::get_if<tcalc::number>(&result))
+                _out.write(num->string(_options.digits, _options.format));
+            else if (const auto* boolean = std::get_if<bool>(&result))
+                _out.write(*boolean ? "true" : "false");
+            else
+                _out.write(std::get<tcalc::assign_result>(result).value.string(_options.digits, _options.format));
+        }
+
+        const batch_options& _options;
+        tcalc::evaluator _evaluator;
+        tcalc::parser _parser;
+        std::vector<tcalc::expression> _expressions;
+        std::unique_ptr<tcalc::parse_cache> _cache;
+        buffered_writer& _out;
+    };
+
+    bool process_stdin(batch_runner& runner)
+    {
+        std::vector<char> buffer(block_size);
+        std::size_t filled = 0;
+
+        while (true)
+        {
+            if (filled == buffer.size())
+                buffer.resize(buffer.size() * 2); // a single line longer than the buffer
+
+            const std::size_t read = std::fread(buffer.data() + filled, 1, buffer.size() - filled, stdin);
+            filled += read;
+            if (read == 0)
+                break;
+
+            const std::string_view data{buffer.data(), filled};
+            const std::size_t last_newline = data.rfind('\n');
+            if (last_newline == std::string_view::npos)
+                continue;
+
+            runner.process(data.substr(0, last_newline + 1));
+            const std::size_t rest = filled - (last_newline + 1);
+            std::memmove(buffer.data(), buffer.data() + last_newline + 1, rest);
+            filled = rest;
+        }
+
+        runner.process({buffer.data(), filled});
+        return !std::ferror(stdin);
+    }
+
+    // Evaluates lines independently on several threads; variables and Ans do not carry over from line to line.
+    void process_parallel(const batch_options& options, buffered_writer& out,
+                          const std::function<bool(std::string&)>& read_line)
+    {
+        const tcalc::evaluator prototype{options.precision};
+        tcalc::pipeline pipeline{prototype, {
+            .parse_workers = std::max<size_t>(1, options.jobs / 4),
+            .eval_workers = options.jobs,
+            .comma_arg_separator = options.comma_arg_separator,
+            .digits = options.digits,
+            .format = options.format
+        }};
+
+        pipeline.run(read_line, [&out](const std::string_view result)
+        {
+            out.write(result);
+            out.put('\n');
+        });
+    }
+
+    // Parses the whole of text as a decimal integer no smaller than min.
+    template <typename T>
+    bool parse_integer(const std::string_view text, T& out, const T min)
+    {
+        T value{};
+        const auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+        if (ec != std::errc{} || end != text.data() + text.size() || value < min)
+            return false;
+        out = value;
+        return true;
+    }
+
+    bool parse_options(const int argc, char* argv[], batch_options& options)
+    {
+        for (int i = 2; i < argc; i++)
+        {
+            const std::string_view arg = argv[i];
+            const bool has_value = i + 1 < argc;
+
+            if (arg == "--format" && has_value)
+            {
+                const std::string_view value = argv[++i];
+                if (value == "normal")
+                    options.format = tcalc::number_format::normal;
+                else if (value == "fixed")
+                    options.format = tcalc::number_format::fixed_point;
+                else if (value == "scientific")
+                    options.format = tcalc::number_format::scientific;
+                else
+                    return false;
+            }
+            else if (arg == "--digits" && has_value)
+            {
+                if (!parse_integer(argv[++i], options.digits, 0))
+                    return false;
+            }
+            else if (arg == "--precision" && has_value)
+            {
+                if (!parse_integer(argv[++i], options.precision, 2L))
+                    return false;
+            }
+            else if (arg == "--parse-cache" && has_value)
+            {
+                if (!parse_integer<size_t>(argv[++i], options.parse_cache_size, 0))
+                    return false;
+            }
+            else if (arg == "--jobs" && has_value)
+            {
+                if (!parse_integer<size_t>(argv[++i], options.jobs, 1))
+                    return false;
+            }
+            else if (arg == "--semicolon-separator")
+            {
+                options.comma_arg_separator = false;
+            }
+            else if (options.path == nullptr && (arg == "-" || !arg.starts_with("--")))
+            {
+                options.path = argv[i];
+            }
+            else
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+int batch(const int argc, char* argv[])
+{
+    batch_options options;
+    if (!parse_options(argc, argv, options))
+    {
+        std::cerr << "usage: tcalc batch [--format normal|fixed|scientific] [--digits N] [--precision N]"
+                     " [--parse-cache N] [--jobs N] [--semicolon-separator] [file|-]\n"
+                     "  --jobs N  evaluate lines independently on N threads; variables and Ans do not carry over\n"
+                     "            from one line to the next, so lines that use them give undefined_variable errors\n";
+        return 2;
+    }
+
+    buffered_writer out{stdout};
+    const bool from_stdin = options.path == nullptr || std::strcmp(options.path, "-") == 0;
+
+    if (options.jobs > 1 && from_stdin)
+    {
+        std::ios::sync_with_stdio(false);
+        process_parallel(options, out, [](std::string& line)
+        {
+            if (!std::getline(std::cin, line))
+                return false;
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            return true;
+        });
+        if (std::cin.bad())
+        {
+            std::cerr << "tcalc: error reading standard input\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    batch_runner runner{options, out};
+
+    if (from_stdin)
+    {
+        if (!process_stdin(runner))
+        {
+            std::cerr << "tcalc: error reading standard input\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    const mapped_file file{options.path};
+    if (!file.good())
+    {
+        std::cerr << "tcalc: cannot read " << options.path << '\n';
+        return 1;
+    }
+    if (options.jobs > 1)
+    {
+        std::string_view rest = file.view();
+        process_parallel(options, out, [&rest](std::string& line)
+        {
+            if (rest.empty())
+                return false;
+            const std::size_t newline = rest.find('\n');
+            std::string_view view = rest.substr(0, newline);
+            rest.remove_prefix(newline == std::string_view::npos ? rest.size() : newline + 1);
+            if (!view.empty() && view.back() == '\r')
+                view.remove_suffix(1);
+            line.assign(view);
+            return true;
+        });
+        return 0;
+    }
+
+    runner.process(file.view());
+    return 0;
+}
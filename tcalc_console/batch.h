@@ -0,0 +1,9 @@
+#ifndef TCALC_BATCH_H
+#define TCALC_BATCH_H
+
+// Non-interactive mode: evaluates one expression per input line, read from a memory-mapped file or from stdin in large
+// blocks, and writes one result per output line. With --jobs N, lines are evaluated independently on N threads, so
+// variables and Ans only carry over within a line.
+int batch(int argc, char* argv[]);
+
+#endif // TCALC_BATCH_H
@@ -0,0 +1,227 @@
+#include "bench.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef _MSC_VER
+#pragma warning(push, 0)
+#endif
+
+#include <gmp.h>
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#include "report.h"
+#include "tc_evaluator.h"
+#include "tc_lexer.h"
+#include "tc_parser.h"
+
+namespace
+{
+    using clock = std::chrono::steady_clock;
+
+    enum phase
+    {
+        lex,
+        parse,
+        evaluate,
+        format,
+        phase_count
+    };
+
+    constexpr std::array<const char*, phase_count> phase_names = {"lex", "parse", "evaluate", "format"};
+
+    struct phase_samples
+    {
+        std::vector<double> nanoseconds;
+        uint64_t allocations = 0;
+    };
+
+    // Allocations are counted through the GMP memory functions that bench installs for its run, which MPFR and MPC
+    // also go through, so the rest of the console keeps the default allocators.
+    thread_local uint64_t allocation_count = 0;
+
+    void* gmp_alloc(const size_t size)
+    {
+        allocation_count++;
+        return std::malloc(size);
+    }
+
+    void* gmp_realloc(void* ptr, size_t, const size_t new_size)
+    {
+        allocation_count++;
+        return std::realloc(ptr, new_size);
+    }
+
+    void gmp_free(void* ptr, size_t)
+    {
+        std::free(ptr);
+    }
+
+    // Times one phase of one expression and counts its GMP allocations.
+    template<class Fn>
+    void measure(phase_samples& samples, Fn&& fn)
+    {
+        const uint64_t allocations_before = allocation_count;
+        const auto start = clock::now();
+        fn();
+        const auto elapsed = clock::now() - start;
+        samples.allocations += allocation_count - allocations_before;
+        samples.nanoseconds.push_back(std::chrono::duration<double, std::nano>(elapsed).count());
+    }
+
+    void write_phase(std::ostream& out, phase_samples& samples)
+    {
+        auto& ns = samples.nanoseconds;
+        std::ranges::sort(ns);
+        double total = 0;
+        for (const double sample : ns)
+            total += sample;
+        const double count = static_cast<double>(ns.size());
+        const double allocations = ns.empty() ? 0 : static_cast<double>(samples.allocations) / count;
+
+        out << "{\"samples\": " << ns.size()
+            << ", \"mean_ns\": " << (ns.empty() ? 0 : total / count)
+            << ", \"p50_ns\": " << percentile(ns, 0.5)
+            << ", \"p99_ns\": " << percentile(ns, 0.99)
+            << ", \"throughput_per_s\": " << (total > 0 ? count / (total / 1e9) : 0)
+            << ", \"gmp_allocations_per_expression\": " << allocations
+            << '}';
+    }
+}
+
+int bench(const int argc, char* argv[])
+{
+    const char* path = nullptr;
+    long precision = 64;
+    long iterations = 10;
+    for (int i = 2; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--precision") == 0 && i + 1 < argc)
+            precision = std::atol(argv[++i]);
+        else if (std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+            iterations = std::atol(argv[++i]);
+        else if (path == nullptr)
+            path = argv[i];
+        else
+            path = "";
+    }
+    if (path == nullptr || *path == '\0' || precision < 2 || iterations < 1)
+    {
+        std::cerr << "usage: tcalc bench <file> [--precision N] [--iterations K]\n";
+        return 2;
+    }
+
+    std::ifstream file{path, std::ios::binary};
+    if (!file)
+    {
+        std::cerr << "tcalc: cannot read " << path << '\n';
+        return 1;
+    }
+
+    std::vector<std::string> corpus;
+    for (std::string line; std::getline(file, line);)
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (line.find_first_not_of(" \t") != std::string::npos)
+            corpus.push_back(std::move(line));
+    }
+
+    mp_set_memory_functions(&gmp_alloc, &gmp_realloc, &gmp_free);
+
+    std::array<phase_samples, phase_count> samples;
+    for (auto& phase : samples)
+        phase.nanoseconds.reserve(corpus.size() * static_cast<size_t>(iterations));
+
+    uint64_t parse_errors = 0;
+    uint64_t eval_errors = 0;
+    tcalc::evaluator evaluator{precision};
+    tcalc::parser parser{tcalc::lexer::borrowing({}, true), precision};
+    std::vector<tcalc::expression> expressions;
+    std::vector<tcalc::evaluator::result_type> results;
+    std::string formatted;
+
+    const auto start = clock::now();
+    for (long iteration = 0; iteration < iterations; iteration++)
+    {
+        for (const auto& input : corpus)
+        {
+            measure(samples[lex], [&]
+            {
+                auto lexer = tcalc::lexer::borrowing(input, true);
+                while (lexer.next().kind() != tcalc::token_kind::end_of_file)
+                {
+                }
+            });
+
+            // The parser pulls its tokens from the lexer, so this phase includes lexing again.
+            measure(samples[parse], [&]
+            {
+                parser.reset(input);
+                parser.parse_all(expressions);
+            });
+            if (!parser.diagnostic_bag().empty())
+            {
+                parse_errors++;
+                continue;
+            }
+
+            results.clear();
+            measure(samples[evaluate], [&]
+            {
+                for (const auto& expr : expressions)
+                {
+                    auto res = evaluator.evaluate(expr);
+                    if (res.is_error())
+                    {
+                        eval_errors++;
+                        break;
+                    }
+                    evaluator.commit_result(res.value());
+                    results.push_back(std::move(res.mut_value()));
+                }
+            });
+
+            measure(samples[format], [&]
+            {
+                for (const auto& result : results)
+                {
+                    if (const auto* num = std::get_if<tcalc::number>(&result))
+                        formatted = num->string();
+                    else if (const auto* asgn = std::get_if<tcalc::assign_result>(&result))
+                        formatted = asgn->value.string();
+                }
+            });
+        }
+    }
+    const std::chrono::duration<double> wall = clock::now() - start;
+
+    std::cout << "{\"corpus\": ";
+    std::cout << json_string(path);
+    std::cout << ", \"expressions\": " << corpus.size()
+        << ", \"iterations\": " << iterations
+        << ", \"precision\": " << precision
+        << ", \"parse_errors\": " << parse_errors
+        << ", \"eval_errors\": " << eval_errors
+        << ", \"wall_seconds\": " << wall.count()
+        << ", \"phases\": {";
+    for (size_t i = 0; i < phase_count; i++)
+    {
+        std::cout << (i == 0 ? "" : ", ") << '"' << phase_names[i] << "\": ";
+        write_phase(std::cout, samples[i]);
+    }
+    std::cout << "}}\n";
+    return 0;
+}
@@ -0,0 +1,7 @@
+#ifndef TCALC_BENCH_H
+#define TCALC_BENCH_H
+
+// Replays a corpus of expressions, one per line, and reports per-phase latency, throughput and allocations as JSON.
+int bench(int argc, char* argv[]);
+
+#endif // TCALC_BENCH_H
@@ -0,0 +1,354 @@
+#include "fuzz.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tc_evaluator.h"
+#include "tc_lexer.h"
+#include "tc_parser.h"
+
+namespace
+{
+    using clock = std::chrono::steady_clock;
+
+    constexpr long precision = 64;
+    constexpr size_t slowest_kept = 10;
+    constexpr size_t error_type_count = static_cast<size_t>(tcalc::eval_error_type::nan_error) + 1;
+    constexpr size_t diagnostic_type_count = static_cast<size_t>(tcalc::diagnostic_type::too_many_symbols) + 1;
+
+    struct fuzz_options
+    {
+        long iterations = 10000;
+        unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+        uint64_t seed = std::random_device{}();
+        bool bytes = false;
+    };
+
+    struct timed_input
+    {
+        double milliseconds;
+        std::string input;
+    };
+
+    struct fuzz_report
+    {
+        uint64_t executions = 0;
+        std::array<uint64_t, error_type_count> errors{};
+        std::array<uint64_t, diagnostic_type_count> diagnostics{};
+        std::vector<timed_input> slowest; // Sorted slowest first
+
+        void add_timing(const double milliseconds, const std::string& input)
+        {
+            if (slowest.size() == slowest_kept && milliseconds <= slowest.back().milliseconds)
+                return;
+            const auto at = std::ranges::upper_bound(slowest, milliseconds, std::greater{}, &timed_input::milliseconds);
+            slowest.insert(at, {milliseconds, input});
+            if (slowest.size() > slowest_kept)
+                slowest.pop_back();
+        }
+
+        void merge(const fuzz_report& other)
+        {
+            executions += other.executions;
+            for (size_t i = 0; i < errors.size(); i++)
+                errors[i] += other.errors[i];
+            for (size_t i = 0; i < diagnostics.size(); i++)
+                diagnostics[i] += other.diagnostics[i];
+            for (const auto& timed : other.slowest)
+                add_timing(timed.milliseconds, timed.input);
+        }
+    };
+
+    // Produces syntactically plausible expressions by walking the grammar the parser accepts, with a small chance of
+    // breaking it so that the error paths still get exercised.
+    class expression_generator final
+    {
+    public:
+        explicit expression_generator(const uint64_t seed) :
+            _rand{seed},
+            _functions{tcalc::evaluator::builtin_signatures()}
+        {
+        }
+
+        std::string statement()
+        {
+            std::string out;
+            switch (pick(10))
+            {
+                case 0:
+                    out += pick_from(assignable);
+                    out += '=';
+                    expression(out, max_depth);
+                    break;
+                case 1:
+                    expression(out, max_depth);
+                    out += pick_from(comparisons);
+                    expression(out, max_depth);
+                    break;
+                default:
+                    expression(out, max_depth);
+                    break;
+            }
+
+            if (pick(20) == 0 && !out.empty())
+                out.erase(pick(out.size()), 1); // Occasionally break the syntax
+            return out;
+        }
+
+    private:
+        static constexpr int max_depth = 6;
+        static constexpr std::array<std::string_view, 6> comparisons = {"=", "==", "!=", "<", ">=", "≤"};
+        static constexpr std::array<std::string_view, 14> binary_ops = {
+            "+", "-", "*", "/", "^", "×", "÷", "<<", ">>", " AND ", " OR ", " XOR ", " NAND ", " NOR "
+        };
+        static constexpr std::array<std::string_view, 8> postfix_ops = {"!", "%", "°", "deg", "rad", "grad", "²", "⁻¹"};
+        static constexpr std::array<std::string_view, 5> prefix_ops = {"-", "+", "√", "∛", "∜"};
+        static constexpr std::array<std::string_view, 5> assignable = {"x", "y", "z", "Ans", "pi"};
+        static constexpr std::array<std::string_view, 9> variables = {"x", "y", "z", "Ans", "pi", "π", "e", "τ", "i"};
+
+        size_t pick(const size_t n)
+        {
+            return std::uniform_int_distribution<size_t>{0, n - 1}(_rand);
+        }
+
+        template<class Container>
+        std::string_view pick_from(const Container& options)
+        {
+            return options[pick(options.size())];
+        }
+
+        void literal(std::string& out)
+        {
+            switch (pick(8))
+            {
+                case 0:
+                    out += "0x";
+                    out += std::to_string(pick(1 << 16));
+                    break;
+                case 1:
+                    out += "0b101";
+                    break;
+                case 2:
+                    out += std::to_string(pick(1000));
+                    out += 'e';
+                    out += std::to_string(static_cast<int>(pick(40)) - 20);
+                    break;
+                case 3:
+                    out += std::to_string(pick(100));
+                    out += "i";
+                    break;
+                case 4:
+                    out += std::to_string(pick(10));
+                    out += '.';
+                    out += std::to_string(pick(100000));
+                    break;
+                case 5:
+                    out += "³√";
+                    out += std::to_string(pick(100));
+                    break;
+                default:
+                    out += std::to_string(pick(pick(3) == 0 ? 1000000 : 10));
+                    break;
+            }
+        }
+
+        void function_call(std::string& out, const int depth)
+        {
+            const auto& [name, arity] = _functions[pick(_functions.size())];
+            out += name;
+            out += '(';
+            const auto args = pick(10) == 0 ? static_cast<tcalc::fn_arity_t>(pick(4)) : arity; // Sometimes wrong
+            for (tcalc::fn_arity_t i = 0; i < args; i++)
+            {
+                if (i != 0)
+                    out += ',';
+                expression(out, depth - 1);
+            }
+            out += ')';
+        }
+
+        void expression(std::string& out, const int depth)
+        {
+            const size_t choice = depth <= 0 ? pick(2) : pick(9);
+            switch (choice)
+            {
+                case 0:
+                    literal(out);
+                    break;
+                case 1:
+                    out += pick_from(variables);
+                    break;
+                case 2:
+                    out += pick_from(prefix_ops);
+                    expression(out, depth - 1);
+                    break;
+                case 3:
+                    expression(out, depth - 1);
+                    out += pick_from(postfix_ops);
+                    break;
+                case 4:
+                    out += '(';
+                    expression(out, depth - 1);
+                    out += ')';
+                    break;
+                case 5:
+                case 6:
+                    function_call(out, depth);
+                    break;
+                case 7:
+                    literal(out); // Implicit multiplication
+                    out += pick_from(variables);
+                    break;
+                default:
+                    expression(out, depth - 1);
+                    out += pick_from(binary_ops);
+                    expression(out, depth - 1);
+                    break;
+            }
+        }
+
+        std::mt19937_64 _rand;
+        std::vector<std::pair<std::string_view, tcalc::fn_arity_t>> _functions;
+    };
+
+    std::string random_bytes(std::mt19937_64& rand)
+    {
+        std::string bytes(512, '\0');
+        std::uniform_int_distribution byte_dist{0, 255};
+        for (char& c : bytes)
+            c = static_cast<char>(byte_dist(rand));
+        return bytes;
+    }
+
+    void run_one(const std::string& input, tcalc::evaluator& evaluator, tcalc::parser& parser,
+                 std::vector<tcalc::expression>& expressions, fuzz_report& report)
+    {
+        const auto start = clock::now();
+
+        parser.reset(input);
+        parser.parse_all(expressions);
+        if (!parser.diagnostic_bag().empty())
+        {
+            for (const auto& diag : parser.diagnostic_bag())
+                report.diagnostics[static_cast<size_t>(diag.type())]++;
+        }
+        else
+        {
+            for (const auto& expr : expressions)
+            {
+                auto res = evaluator.evaluate(expr);
+                if (res.is_error())
+                {
+                    report.errors[static_cast<size_t>(res.error().type)]++;
+                    break;
+                }
+                report.errors[static_cast<size_t>(tcalc::eval_error_type::none)]++;
+                evaluator.commit_result(res.value());
+            }
+        }
+
+        report.executions++;
+        report.add_timing(std::chrono::duration<double, std::milli>(clock::now() - start).count(), input);
+    }
+
+    bool parse_options(const int argc, char* argv[], fuzz_options& options)
+    {
+        for (int i = 2; i < argc; i++)
+        {
+            const std::string_view arg = argv[i];
+            if (arg == "--threads" && i + 1 < argc)
+                options.threads = static_cast<unsigned>(std::max(1, std::atoi(argv[++i])));
+            else if (arg == "--seed" && i + 1 < argc)
+                options.seed = std::strtoull(argv[++i], nullptr, 10);
+            else if (arg == "--bytes")
+                options.bytes = true;
+            else if (!arg.starts_with("--") && (options.iterations = std::atol(argv[i])) > 0)
+                continue;
+            else
+                return false;
+        }
+        return true;
+    }
+
+    void print_report(const fuzz_report& report, const fuzz_options& options, const double seconds)
+    {
+        std::cout << "executions: " << report.executions << " on " << options.threads << " threads in "
+            << seconds << " s (" << static_cast<double>(report.executions) / seconds << " exec/s), seed "
+            << options.seed << '\n';
+
+        std::cout << "\nevaluation results:\n";
+        for (size_t i = 0; i < error_type_count; i++)
+        {
+            const auto type = static_cast<tcalc::eval_error_type>(i);
+            std::cout << "  " << std::setw(26) << std::left << tcalc::eval_error_type_name(type) << report.errors[i]
+                << (report.errors[i] == 0 ? "  (never reached)" : "") << '\n';
+        }
+
+        std::cout << "\nparse diagnostics:\n";
+        for (size_t i = 0; i < diagnostic_type_count; i++)
+        {
+            const auto type = static_cast<tcalc::diagnostic_type>(i);
+            std::cout << "  " << std::setw(26) << std::left << tcalc::diagnostic_type_name(type)
+                << report.diagnostics[i] << '\n';
+        }
+
+        std::cout << "\nslowest inputs:\n";
+        for (const auto& [milliseconds, input] : report.slowest)
+            std::cout << "  " << std::setw(10) << std::right << milliseconds << " ms  " << std::quoted(input) << '\n';
+    }
+}
+
+int fuzz(const int argc, char* argv[])
+{
+    fuzz_options options;
+    if (!parse_options(argc, argv, options))
+    {
+        std::cerr << "usage: tcalc fuzz [iterations] [--threads N] [--seed S] [--bytes]\n";
+        return 2;
+    }
+
+    std::atomic<long> remaining{options.iterations};
+    std::mutex report_mutex;
+    fuzz_report total;
+    std::vector<std::thread> threads;
+
+    const auto start = clock::now();
+    for (unsigned t = 0; t < options.threads; t++)
+    {
+        threads.emplace_back([&, t]
+        {
+            const uint64_t seed = options.seed + t;
+            expression_generator generator{seed};
+            std::mt19937_64 byte_rand{seed};
+            tcalc::evaluator evaluator{precision};
+            tcalc::parser parser{tcalc::lexer::borrowing({}, true), precision};
+            std::vector<tcalc::expression> expressions;
+            fuzz_report report;
+
+            while (remaining.fetch_sub(1, std::memory_order_relaxed) > 0)
+            {
+                const std::string input = options.bytes ? random_bytes(byte_rand) : generator.statement();
+                run_one(input, evaluator, parser, expressions, report);
+            }
+
+            tcalc::number::free_thread_caches();
+            std::lock_guard lock{report_mutex};
+            total.merge(report);
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+
+    print_report(total, options, std::chrono::duration<double>(clock::now() - start).count());
+    return 0;
+}
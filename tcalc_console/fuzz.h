@@ -0,0 +1,8 @@
+#ifndef TCALC_FUZZ_H
+#define TCALC_FUZZ_H
+
+// Generates random expressions from the token grammar, or random bytes with --bytes, and evaluates them on several
+// threads, reporting throughput, which errors were reached and the slowest inputs.
+int fuzz(int argc, char* argv[]);
+
+#endif // TCALC_FUZZ_H
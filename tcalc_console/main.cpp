@@ -1,16 +1,23 @@
-#include <array>
+#include <algorithm>
 #include <iostream>
 #include <format>
-#include <random>
+#include <fstream>
 #include <cstring>
 #include <iomanip>
 #include <chrono>
 
+#include "accuracy.h"
+#include "batch.h"
+#include "bench.h"
+#include "fuzz.h"
+#include "serve.h"
+#include "sweep.h"
 #include "tc_evaluator.h"
 #include "tc_expression.h"
 #include "tc_lexer.h"
 #include "tc_number.h"
 #include "tc_parser.h"
+#include "tc_trace.h"
 
 #ifdef _WIN32
 #include <windows.h>
@@ -106,9 +113,7 @@ static void interactive()
     {
         std::string input;
         std::cout << "> ";
-        std::getline(std::cin, input);
-
-        if (input == "quit")
+        if (!std::getline(std::cin, input) || input == "quit")
             return;
 
         eval(evaluator, std::move(input), true);
@@ -118,22 +123,41 @@ static void interactive()
     
 }
 
-static void fuzz(const int times)
+// Removes --trace <path> from the arguments, so that every mode accepts it, and returns the path if it was given
+static const char* take_trace_path(int& argc, char* argv[])
 {
-    std::random_device rd;
-    std::default_random_engine rand(rd());
-    std::uniform_int_distribution rdist(0, 255);
-    std::array<char, 512> buf{};
-    tcalc::evaluator evaluator{prec};
-
-    for (int i = 0; i < times; i++)
+    for (int i = 1; i + 1 < argc; i++)
     {
-        for (char& j : buf)
-            j = static_cast<char>(rdist(rand));
-        std::cout << "Fuzz #" << i + 1 << '\n';
-        std::string a{buf.cbegin(), buf.cend()};
-        eval(evaluator, std::move(a), false);
+        if (std::strcmp(argv[i], "--trace") != 0)
+            continue;
+
+        const char* path = argv[i + 1];
+        std::copy(argv + i + 2, argv + argc + 1, argv + i); // Including the terminating null
+        argc -= 2;
+        return path;
     }
+    return nullptr;
+}
+
+static int run(int argc, char* argv[])
+{
+    if (argc >= 2 && std::strcmp(argv[1], "accuracy") == 0)
+        return accuracy(argc, argv);
+    if (argc >= 2 && std::strcmp(argv[1], "batch") == 0)
+        return batch(argc, argv);
+    if (argc >= 2 && std::strcmp(argv[1], "bench") == 0)
+        return bench(argc, argv);
+    if (argc >= 2 && std::strcmp(argv[1], "fuzz") == 0)
+        return fuzz(argc, argv);
+    if (argc >= 2 && std::strcmp(argv[1], "serve") == 0)
+        return serve(argc, argv);
+    if (argc >= 2 && std::strcmp(argv[1], "serve-load") == 0)
+        return serve_load(argc, argv);
+    if (argc >= 2 && std::strcmp(argv[1], "sweep") == 0)
+        return sweep(argc, argv);
+
+    interactive();
+    return 0;
 }
 
 int main(int argc, char* argv[])
@@ -142,8 +166,21 @@ int main(int argc, char* argv[])
     SetConsoleCP(CP_UTF8);
     SetConsoleOutputCP(CP_UTF8);
 #endif
-    if (argc == 3 && std::strcmp(argv[1], "fuzz") == 0)
-        fuzz(std::stoi(argv[2]));
-    else
-        interactive();
+    const char* trace_path = take_trace_path(argc, argv);
+    if (trace_path != nullptr)
+        tcalc::start_tracing();
+
+    const int status = run(argc, argv);
+    if (trace_path == nullptr)
+        return status;
+
+    tcalc::stop_tracing();
+    std::ofstream trace{trace_path, std::ios::binary};
+    tcalc::write_trace(trace);
+    if (!trace.flush())
+    {
+        std::cerr << "tcalc: cannot write " << trace_path << '\n';
+        return status == 0 ? 1 : status;
+    }
+    return status;
 }
\ No newline at end of file
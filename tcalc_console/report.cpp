@@ -0,0 +1,58 @@
+#include "report.h"
+
+#include <algorithm>
+#include <cstdio>
+
+double percentile(const std::vector<double>& sorted, const double p)
+{
+    if (sorted.empty())
+        return 0;
+    const auto rank = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+void append_json_string(std::string& out, const std::string_view str)
+{
+    out += '"';
+    for (const char c : str)
+    {
+        switch (c)
+        {
+            case '"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            case '\r':
+                out += "\\r";
+                break;
+            case '\t':
+                out += "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20)
+                {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof escaped, "\\u%04x", static_cast<unsigned>(c));
+                    out += escaped;
+                }
+                else
+                {
+                    out += c;
+                }
+                break;
+        }
+    }
+    out += '"';
+}
+
+std::string json_string(const std::string_view str)
+{
+    std::string out;
+    append_json_string(out, str);
+    return out;
+}
@@ -0,0 +1,19 @@
+#ifndef TCALC_REPORT_H
+#define TCALC_REPORT_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Helpers shared by the subcommands that report measurements, mostly as JSON.
+
+// The nearest-rank percentile p, from 0 to 1, of samples sorted in ascending order, or 0 if there are none.
+double percentile(const std::vector<double>& sorted, double p);
+
+// Appends str to out as a quoted JSON string.
+void append_json_string(std::string& out, std::string_view str);
+
+[[nodiscard]]
+std::string json_string(std::string_view str);
+
+#endif // TCALC_REPORT_H
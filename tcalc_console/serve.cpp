@@ -0,0 +1,1186 @@
+#include "serve.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "report.h"
+#include "tc_evaluator.h"
+#include "tc_parse_cache.h"
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <csignal>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    using clock = std::chrono::steady_clock;
+
+    constexpr size_t read_block_size = 1 << 16;
+    constexpr size_t max_line_length = 1 << 24;
+    constexpr std::chrono::seconds eviction_interval{1}; // Between sweeps for idle sessions
+    constexpr long max_precision = 1 << 16;
+    constexpr int max_digits = max_precision * 30103 / 100000 + 1; // Decimal digits carried by max_precision bits
+
+    // Line-oriented reading and whole-line writing over a pair of file descriptors, which may be the same socket.
+    class line_stream final
+    {
+    public:
+        line_stream(const int in_fd, const int out_fd, const bool owns) :
+            _in{in_fd},
+            _out{out_fd},
+            _owns{owns}
+        {
+        }
+
+        line_stream(const line_stream&) = delete;
+        line_stream& operator=(const line_stream&) = delete;
+
+        ~line_stream()
+        {
+#ifndef _WIN32
+            if (_owns)
+            {
+                close(_in);
+                if (_out != _in)
+                    close(_out);
+            }
+#endif
+        }
+
+        // Returns false at the end of the input, or when a line is longer than max_line_length.
+        bool read_line(std::string& line)
+        {
+            while (true)
+            {
+                const size_t newline = _buffer.find('\n', _scanned);
+                if (newline != std::string::npos)
+                {
+                    line.assign(_buffer, 0, newline);
+                    if (!line.empty() && line.back() == '\r')
+                        line.pop_back();
+                    _buffer.erase(0, newline + 1);
+                    _scanned = 0;
+                    return true;
+                }
+
+                _scanned = _buffer.size();
+                if (_buffer.size() > max_line_length)
+                    return false;
+
+                char block[read_block_size];
+                const auto got = raw_read(block, sizeof block);
+                if (got <= 0)
+                {
+                    if (_buffer.empty())
+                        return false;
+                    line = std::move(_buffer); // Last line without a newline
+                    _buffer.clear();
+                    _scanned = 0;
+                    return true;
+                }
+                _buffer.append(block, static_cast<size_t>(got));
+            }
+        }
+
+        // Makes a blocked or later read_line return false while responses can still be written, to shut down.
+        void close_input() const
+        {
+#ifndef _WIN32
+            shutdown(_in, SHUT_RD);
+#endif
+        }
+
+        // Writes the line and a newline atomically with respect to other writers of this stream.
+        bool write_line(const std::string_view line)
+        {
+            std::lock_guard lock{_write_mutex};
+            return write_all(line) && write_all("\n");
+        }
+
+    private:
+        long raw_read(char* data, const size_t size) const
+        {
+#ifdef _WIN32
+            return _read(_in, data, static_cast<unsigned>(size));
+#else
+            ssize_t got;
+            do
+                got = read(_in, data, size);
+            while (got < 0 && errno == EINTR);
+            return got;
+#endif
+        }
+
+        bool write_all(std::string_view data) const
+        {
+            while (!data.empty())
+            {
+#ifdef _WIN32
+                const long written = _write(_out, data.data(), static_cast<unsigned>(data.size()));
+#else
+                const ssize_t written = write(_out, data.data(), data.size());
+                if (written < 0 && errno == EINTR)
+                    continue;
+#endif
+                if (written <= 0)
+                    return false;
+                data.remove_prefix(static_cast<size_t>(written));
+            }
+            return true;
+        }
+
+        int _in;
+        int _out;
+        bool _owns;
+        std::string _buffer;
+        size_t _scanned = 0; // Bytes of _buffer already known to hold no newline
+        std::mutex _write_mutex;
+    };
+
+    // A scalar member of a request object. Strings are unescaped, numbers and literals are kept as written.
+    struct json_scalar
+    {
+        bool is_string;
+        std::string text;
+    };
+
+    // Parses a flat JSON object whose members are all strings, numbers, booleans or null.
+    class json_object_reader final
+    {
+    public:
+        explicit json_object_reader(const std::string_view text) : _text{text}
+        {
+        }
+
+        std::optional<std::map<std::string, json_scalar, std::less<>>> read()
+        {
+            std::map<std::string, json_scalar, std::less<>> members;
+            if (!consume('{'))
+                return std::nullopt;
+            if (consume('}'))
+                return at_end() ? std::optional{std::move(members)} : std::nullopt;
+
+            do
+            {
+                std::string key;
+                json_scalar value;
+                if (!read_string(key) || !consume(':') || !read_scalar(value))
+                    return std::nullopt;
+                members.insert_or_assign(std::move(key), std::move(value));
+            }
+            while (consume(','));
+
+            if (!consume('}') || !at_end())
+                return std::nullopt;
+            return members;
+        }
+
+    private:
+        void skip_space()
+        {
+            while (_pos < _text.size() && (_text[_pos] == ' ' || _text[_pos] == '\t' || _text[_pos] == '\r' ||
+                                           _text[_pos] == '\n'))
+                _pos++;
+        }
+
+        bool consume(const char c)
+        {
+            skip_space();
+            if (_pos < _text.size() && _text[_pos] == c)
+            {
+                _pos++;
+                return true;
+            }
+            return false;
+        }
+
+        bool at_end()
+        {
+            skip_space();
+            return _pos == _text.size();
+        }
+
+        bool read_hex4(uint32_t& value)
+        {
+            if (_pos + 4 > _text.size())
+                return false;
+            const auto [end, ec] = std::from_chars(_text.data() + _pos, _text.data() + _pos + 4, value, 16);
+            if (ec != std::errc{} || end != _text.data() + _pos + 4)
+                return false;
+            _pos += 4;
+            return true;
+        }
+
+        static void append_utf8(std::string& out, const uint32_t cp)
+        {
+            if (cp < 0x80)
+            {
+                out += static_cast<char>(cp);
+            }
+            else if (cp < 0x800)
+            {
+                out += static_cast<char>(0xC0 | cp >> 6);
+                out += static_cast<char>(0x80 | (cp & 0x3F));
+            }
+            else if (cp < 0x10000)
+            {
+                out += static_cast<char>(0xE0 | cp >> 12);
+                out += static_cast<char>(0x80 | (cp >> 6 & 0x3F));
+                out += static_cast<char>(0x80 | (cp & 0x3F));
+            }
+            else
+            {
+                out += static_cast<char>(0xF0 | cp >> 18);
+                out += static_cast<char>(0x80 | (cp >> 12 & 0x3F));
+                out += static_cast<char>(0x80 | (cp >> 6 & 0x3F));
+                out += static_cast<char>(0x80 | (cp & 0x3F));
+            }
+        }
+
+        bool read_string(std::string& out)
+        {
+            if (!consume('"'))
+                return false;
+
+            while (_pos < _text.size())
+            {
+                const char c = _text[_pos++];
+                if (c == '"')
+                    return true;
+                if (c != '\\')
+                {
+                    out += c;
+                    continue;
+                }
+                if (_pos == _text.size())
+                    return false;
+
+                switch (_text[_pos++])
+                {
+                    case '"':
+                        out += '"';
+                        break;
+                    case '\\':
+                        out += '\\';
+                        break;
+                    case '/':
+                        out += '/';
+                        break;
+                    case 'b':
+                        out += '\b';
+                        break;
+                    case 'f':
+                        out += '\f';
+                        break;
+                    case 'n':
+                        out += '\n';
+                        break;
+                    case 'r':
+                        out += '\r';
+                        break;
+                    case 't':
+                        out += '\t';
+                        break;
+                    case 'u':
+                    {
+                        uint32_t cp;
+                        if (!read_hex4(cp))
+                            return false;
+                        if (cp >= 0xD800 && cp < 0xDC00) // High surrogate, expect the low half
+                        {
+                            uint32_t low;
+                            if (_text.substr(_pos, 2) != "\\u")
+                                return false;
+                            _pos += 2;
+                            if (!read_hex4(low) || low < 0xDC00 || low >= 0xE000)
+                                return false;
+                            cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                        }
+                        append_utf8(out, cp);
+                        break;
+                    }
+                    default:
+                        return false;
+                }
+            }
+            return false;
+        }
+
+        bool read_scalar(json_scalar& value)
+        {
+            skip_space();
+            if (_pos < _text.size() && _text[_pos] == '"')
+            {
+                value.is_string = true;
+                return read_string(value.text);
+            }
+
+            const size_t start = _pos;
+            while (_pos < _text.size() && _text[_pos] != ',' && _text[_pos] != '}' && _text[_pos] != ' ' &&
+                   _text[_pos] != '\t' && _text[_pos] != '\r' && _text[_pos] != '\n')
+                _pos++;
+            value.is_string = false;
+            value.text = _text.substr(start, _pos - start);
+
+            if (value.text == "true" || value.text == "false" || value.text == "null")
+                return true;
+            double number;
+            const auto [end, ec] = std::from_chars(value.text.data(), value.text.data() + value.text.size(), number);
+            return !value.text.empty() && ec == std::errc{} && end == value.text.data() + value.text.size();
+        }
+
+        std::string_view _text;
+        size_t _pos = 0;
+    };
+
+    struct serve_options
+    {
+        const char* socket_path = nullptr;
+        size_t workers = std::max(1u, std::thread::hardware_concurrency());
+        size_t parse_cache_size = 4096;
+        long precision = 64;
+        size_t max_sessions = 1 << 16;
+        std::chrono::seconds session_idle{600};
+    };
+
+    struct request
+    {
+        std::string id = "null"; // Serialized JSON, echoed back verbatim
+        std::string expression;
+        std::string session;
+        long precision = 0; // 0 when omitted: the session's precision, or the server's for a new session
+        std::optional<tcalc::angle_unit> angle;
+        std::optional<bool> complex_mode;
+        int digits = 0;
+        tcalc::number_format format = tcalc::number_format::normal;
+        bool comma_arg_separator = true;
+        bool end_session = false;
+    };
+
+    // Fills the request from a line, or returns the name of the request error.
+    std::string_view read_request(const std::string_view line, request& req)
+    {
+        auto members = json_object_reader{line}.read();
+        if (!members)
+            return "bad_json";
+
+        if (const auto it = members->find("id"); it != members->end())
+        {
+            req.id.clear();
+            if (it->second.is_string)
+                append_json_string(req.id, it->second.text);
+            else
+                req.id = it->second.text;
+        }
+
+        const auto get = [&](const std::string_view name) -> const json_scalar*
+        {
+            const auto it = members->find(name);
+            return it == members->end() || it->second.text == "null" ? nullptr : &it->second;
+        };
+        const auto get_integer = [](const json_scalar& value, auto& out)
+        {
+            const char* end = value.text.data() + value.text.size();
+            const auto [ptr, ec] = std::from_chars(value.text.data(), end, out);
+            return !value.is_string && ec == std::errc{} && ptr == end;
+        };
+        const auto get_bool = [](const json_scalar& value, bool& out)
+        {
+            if (value.is_string || (value.text != "true" && value.text != "false"))
+                return false;
+            out = value.text == "true";
+            return true;
+        };
+
+        const json_scalar* expression = get("expression");
+        if (expression == nullptr || !expression->is_string)
+            return "missing_expression";
+        req.expression = expression->text;
+
+        if (const json_scalar* session = get("session"))
+        {
+            if (!session->is_string)
+                return "bad_session";
+            req.session = session->text;
+        }
+        if (const json_scalar* precision = get("precision"))
+        {
+            if (!get_integer(*precision, req.precision) || req.precision < 2 || req.precision > max_precision)
+                return "bad_precision";
+        }
+        if (const json_scalar* angle = get("angle"))
+        {
+            if (angle->text == "radians")
+                req.angle = tcalc::angle_unit::radians;
+            else if (angle->text == "degrees")
+                req.angle = tcalc::angle_unit::degrees;
+            else if (angle->text == "gradians")
+                req.angle = tcalc::angle_unit::gradians;
+            else
+                return "bad_angle";
+        }
+        if (const json_scalar* complex = get("complex"))
+        {
+            bool mode;
+            if (!get_bool(*complex, mode))
+                return "bad_complex";
+            req.complex_mode = mode;
+        }
+        if (const json_scalar* digits = get("digits"))
+        {
+            if (!get_integer(*digits, req.digits) || req.digits < 0 || req.digits > max_digits)
+                return "bad_digits";
+        }
+        if (const json_scalar* format = get("format"))
+        {
+            if (format->text == "normal")
+                req.format = tcalc::number_format::normal;
+            else if (format->text == "fixed")
+                req.format = tcalc::number_format::fixed_point;
+            else if (format->text == "scientific")
+                req.format = tcalc::number_format::scientific;
+            else
+                return "bad_format";
+        }
+        if (const json_scalar* separator = get("semicolon_separator"))
+        {
+            bool semicolon;
+            if (!get_bool(*separator, semicolon))
+                return "bad_semicolon_separator";
+            req.comma_arg_separator = !semicolon;
+        }
+        if (const json_scalar* end = get("end_session"))
+        {
+            if (!get_bool(*end, req.end_session))
+                return "bad_end_session";
+        }
+        return {};
+    }
+
+    void append_error(std::string& out, const std::string_view kind, const std::string_view type)
+    {
+        out += ",\"error\":{\"kind\":\"";
+        out += kind;
+        out += "\",\"type\":\"";
+        out += type;
+        out += '"';
+    }
+
+    void append_position(std::string& out, const tcalc::source_position& position)
+    {
+        out += ",\"start\":";
+        out += std::to_string(position.start_index);
+        out += ",\"end\":";
+        out += std::to_string(position.end_index);
+        out += '}';
+    }
+
+    void append_result(std::string& out, const tcalc::evaluator::result_type& result, const request& req)
+    {
+        if (const auto* num = std::get_if<tcalc::number>(&result))
+        {
+            append_json_string(out, num->string(req.digits, req.format));
+        }
+        else if (const auto* boolean = std::get_if<bool>(&result))
+        {
+            out += *boolean ? "true" : "false";
+        }
+        else
+        {
+            const auto& assignment = std::get<tcalc::assign_result>(result);
+            out += "{\"variable\":";
+            append_json_string(out, assignment.variable.name());
+            out += ",\"value\":";
+            append_json_string(out, assignment.value.string(req.digits, req.format));
+            out += '}';
+        }
+    }
+
+    struct job
+    {
+        request req;
+        std::shared_ptr<line_stream> client;
+    };
+
+    // Requests sharing a session id run one at a time, in arrival order, on the same evaluator. A request without a
+    // session gets a session of its own. Named sessions last until ended, or until idle for longer than --session-idle.
+    struct session
+    {
+        std::string id;
+        clock::time_point last_used; // Guarded by the server's sessions mutex
+        std::mutex mutex; // Guards pending and scheduled
+        std::deque<job> pending;
+        bool scheduled = false;
+        std::optional<tcalc::evaluator> evaluator; // Only touched by the worker running the session
+    };
+
+    class server final
+    {
+    public:
+        explicit server(const serve_options& options) :
+            _options{options},
+            _cache{options.parse_cache_size}
+        {
+            for (size_t i = 0; i < options.workers; i++)
+                _workers.emplace_back([this]
+                {
+                    work();
+                    tcalc::number::free_thread_caches();
+                });
+        }
+
+        server(const server&) = delete;
+        server& operator=(const server&) = delete;
+
+        ~server()
+        {
+            {
+                std::lock_guard lock{_queue_mutex};
+                _closing = true;
+            }
+            _queue_ready.notify_all();
+            for (auto& worker : _workers)
+                worker.join();
+        }
+
+        // Reads requests from the client until its input ends. Responses may still be in flight afterwards.
+        void handle(const std::shared_ptr<line_stream>& client)
+        {
+            std::string line;
+            while (client->read_line(line))
+            {
+                if (line.find_first_not_of(" \t") == std::string::npos)
+                    continue;
+
+                job next;
+                next.client = client;
+                std::string_view error = read_request(line, next.req);
+                if (error.empty())
+                    error = submit(next);
+                if (!error.empty())
+                {
+                    std::string response = "{\"id\":" + next.req.id;
+                    append_error(response, "request", error);
+                    response += "}}";
+                    client->write_line(response);
+                }
+            }
+        }
+
+#ifndef _WIN32
+        // Reads the client's requests on a thread of its own until its input ends or disconnect_all is called.
+        void serve_client(const std::shared_ptr<line_stream>& client)
+        {
+            {
+                std::lock_guard lock{_clients_mutex};
+                _clients.insert(client);
+            }
+            std::thread{[this, client]
+            {
+                handle(client);
+                std::lock_guard lock{_clients_mutex};
+                _clients.erase(client);
+                _clients_done.notify_all(); // Under the lock, as disconnect_all may destroy the server once it wakes
+            }}.detach();
+        }
+
+        // Stops reading from every client and waits until their threads no longer touch the server.
+        void disconnect_all()
+        {
+            std::unique_lock lock{_clients_mutex};
+            for (const auto& client : _clients)
+                client->close_input();
+            _clients_done.wait(lock, [this] { return _clients.empty(); });
+        }
+#endif
+
+        // Blocks until every submitted request has been answered.
+        void drain()
+        {
+            std::unique_lock lock{_queue_mutex};
+            _idle.wait(lock, [this] { return _outstanding == 0; });
+        }
+
+    private:
+        // Queues the job on its session, moving from it, or returns the name of the request error and leaves it.
+        std::string_view submit(job& next)
+        {
+            std::shared_ptr<session> target;
+            if (next.req.session.empty())
+            {
+                target = std::make_shared<session>();
+            }
+            else
+            {
+                const auto now = clock::now();
+                std::lock_guard lock{_sessions_mutex};
+                auto it = _sessions.find(next.req.session);
+                if (it == _sessions.end())
+                {
+                    if (_sessions.size() >= _options.max_sessions || now - _last_eviction >= eviction_interval)
+                        evict_idle_sessions(now);
+                    if (_sessions.size() >= _options.max_sessions)
+                        return "session_limit";
+
+                    auto created = std::make_shared<session>();
+                    created->id = next.req.session;
+                    it = _sessions.emplace(next.req.session, std::move(created)).first;
+                }
+                it->second->last_used = now;
+                target = it->second;
+            }
+
+            {
+                std::lock_guard lock{_queue_mutex};
+                _outstanding++;
+            }
+
+            bool schedule;
+            {
+                std::lock_guard lock{target->mutex};
+                target->pending.push_back(std::move(next));
+                schedule = !std::exchange(target->scheduled, true);
+            }
+            if (schedule)
+                enqueue(std::move(target));
+            return {};
+        }
+
+        // Drops the sessions idle for longer than --session-idle that have no requests queued or running. Called with
+        // the sessions mutex held.
+        void evict_idle_sessions(const clock::time_point now)
+        {
+            _last_eviction = now;
+            std::erase_if(_sessions, [&](const auto& entry)
+            {
+                session& candidate = *entry.second;
+                if (now - candidate.last_used < _options.session_idle)
+                    return false;
+                std::lock_guard lock{candidate.mutex};
+                return !candidate.scheduled;
+            });
+        }
+
+        void enqueue(std::shared_ptr<session>&& ready)
+        {
+            {
+                std::lock_guard lock{_queue_mutex};
+                _ready.push_back(std::move(ready));
+            }
+            _queue_ready.notify_one();
+        }
+
+        void work()
+        {
+            while (true)
+            {
+                std::shared_ptr<session> current;
+                {
+                    std::unique_lock lock{_queue_mutex};
+                    _queue_ready.wait(lock, [this] { return _closing || !_ready.empty(); });
+                    if (_ready.empty())
+                        return;
+                    current = std::move(_ready.front());
+                    _ready.pop_front();
+                }
+
+                job next;
+                {
+                    std::lock_guard lock{current->mutex};
+                    next = std::move(current->pending.front());
+                    current->pending.pop_front();
+                }
+
+                const std::string response = run(*current, next.req);
+                next.client->write_line(response);
+                if (next.req.end_session)
+                    end_session(current);
+
+                bool more;
+                {
+                    std::lock_guard lock{current->mutex};
+                    more = !current->pending.empty();
+                    current->scheduled = more;
+                }
+                if (more)
+                    enqueue(std::move(current)); // One request per turn keeps busy sessions from starving others
+
+                {
+                    std::lock_guard lock{_queue_mutex};
+                    if (--_outstanding == 0)
+                        _idle.notify_all();
+                }
+            }
+        }
+
+        void end_session(const std::shared_ptr<session>& ended)
+        {
+            std::lock_guard lock{_sessions_mutex};
+            const auto it = _sessions.find(ended->id);
+            if (it != _sessions.end() && it->second == ended)
+                _sessions.erase(it);
+        }
+
+        const tcalc::evaluator& prototype(const long precision)
+        {
+            std::lock_guard lock{_prototypes_mutex};
+            auto& entry = _prototypes[precision];
+            if (entry == nullptr)
+                entry = std::make_unique<tcalc::evaluator>(precision);
+            return *entry;
+        }
+
+        std::string run(session& current, const request& req)
+        {
+            std::string response = "{\"id\":" + req.id;
+
+            long precision = req.precision;
+            if (precision == 0)
+                precision = current.evaluator ? current.evaluator->precision() : _options.precision;
+
+            if (!current.evaluator)
+                current.evaluator.emplace(prototype(precision));
+            else if (current.evaluator->precision() != precision)
+            {
+                append_error(response, "request", "session_precision");
+                response += "}}";
+                return response;
+            }
+
+            tcalc::evaluator& evaluator = *current.evaluator;
+            if (req.angle)
+                evaluator.trig_unit(*req.angle);
+            if (req.complex_mode)
+                evaluator.complex_mode(*req.complex_mode);
+
+            const auto parsed = _cache.parse(req.expression, req.comma_arg_separator, precision);
+            if (!parsed->diagnostics.empty())
+            {
+                const tcalc::diagnostic& first = parsed->diagnostics.front();
+                append_error(response, "parse", tcalc::diagnostic_type_name(first.type()));
+                append_position(response, first.position());
+                response += '}';
+                return response;
+            }
+
+            // Results of the expressions before a failing one are kept, since they were committed
+            response += ",\"results\":[";
+            std::optional<tcalc::eval_error> error;
+            bool first = true;
+            for (const auto& expr : parsed->expressions)
+            {
+                auto res = evaluator.evaluate(expr);
+                if (res.is_error())
+                {
+                    error = res.error();
+                    break;
+                }
+
+                if (!first)
+                    response += ',';
+                first = false;
+                append_result(response, res.value(), req);
+                evaluator.commit_result(res.value());
+            }
+            response += ']';
+
+            if (error)
+            {
+                append_error(response, "eval", tcalc::eval_error_type_name(error->type));
+                append_position(response, error->position);
+            }
+            response += '}';
+            return response;
+        }
+
+        const serve_options& _options;
+        tcalc::parse_cache _cache;
+
+        std::mutex _prototypes_mutex;
+        std::unordered_map<long, std::unique_ptr<tcalc::evaluator>> _prototypes;
+
+        std::mutex _sessions_mutex;
+        std::unordered_map<std::string, std::shared_ptr<session>> _sessions;
+        clock::time_point _last_eviction = clock::now();
+
+        std::mutex _clients_mutex;
+        std::condition_variable _clients_done;
+        std::unordered_set<std::shared_ptr<line_stream>> _clients; // Served on their own threads
+
+        std::mutex _queue_mutex;
+        std::condition_variable _queue_ready;
+        std::condition_variable _idle;
+        std::deque<std::shared_ptr<session>> _ready; // Sessions with pending requests, not being run
+        size_t _outstanding = 0;
+        bool _closing = false;
+
+        std::vector<std::thread> _workers;
+    };
+
+#ifndef _WIN32
+    // Written to by the SIGINT and SIGTERM handler, whichever thread it runs on, to wake the accept loop.
+    int shutdown_pipe[2] = {-1, -1};
+
+    void request_shutdown(int)
+    {
+        const char byte = 0;
+        [[maybe_unused]] const auto written = write(shutdown_pipe[1], &byte, 1);
+    }
+
+    int listen_unix(const char* path)
+    {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (std::strlen(path) >= sizeof address.sun_path)
+            return -1;
+        std::strcpy(address.sun_path, path);
+
+        const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0)
+            return -1;
+        unlink(path);
+        if (bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof address) != 0 || listen(fd, 128) != 0)
+        {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    int connect_unix(const char* path)
+    {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (std::strlen(path) >= sizeof address.sun_path)
+            return -1;
+        std::strcpy(address.sun_path, path);
+
+        const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0)
+            return -1;
+        if (connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof address) != 0)
+        {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+#endif
+
+    bool parse_serve_options(const int argc, char* argv[], serve_options& options)
+    {
+        for (int i = 2; i < argc; i++)
+        {
+            const std::string_view arg = argv[i];
+            const bool has_value = i + 1 < argc;
+
+            if (arg == "--socket" && has_value)
+            {
+                options.socket_path = argv[++i];
+            }
+            else if (arg == "--workers" && has_value)
+            {
+                const long workers = std::atol(argv[++i]);
+                if (workers < 1)
+                    return false;
+                options.workers = static_cast<size_t>(workers);
+            }
+            else if (arg == "--parse-cache" && has_value)
+            {
+                const long size = std::atol(argv[++i]);
+                if (size < 0)
+                    return false;
+                options.parse_cache_size = static_cast<size_t>(size);
+            }
+            else if (arg == "--precision" && has_value)
+            {
+                options.precision = std::atol(argv[++i]);
+                if (options.precision < 2 || options.precision > max_precision)
+                    return false;
+            }
+            else if (arg == "--max-sessions" && has_value)
+            {
+                const long sessions = std::atol(argv[++i]);
+                if (sessions < 1)
+                    return false;
+                options.max_sessions = static_cast<size_t>(sessions);
+            }
+            else if (arg == "--session-idle" && has_value)
+            {
+                const long seconds = std::atol(argv[++i]);
+                if (seconds < 1)
+                    return false;
+                options.session_idle = std::chrono::seconds{seconds};
+            }
+            else
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    struct load_options
+    {
+        const char* socket_path = nullptr;
+        const char* corpus_path = nullptr;
+        size_t connections = 4;
+        size_t requests = 10000; // Per connection
+        size_t depth = 16; // Requests in flight per connection
+        bool sessions = false;
+    };
+
+    bool parse_load_options(const int argc, char* argv[], load_options& options)
+    {
+        for (int i = 2; i < argc; i++)
+        {
+            const std::string_view arg = argv[i];
+            const bool has_value = i + 1 < argc;
+            long value = 1;
+
+            if (arg == "--socket" && has_value)
+                options.socket_path = argv[++i];
+            else if (arg == "--corpus" && has_value)
+                options.corpus_path = argv[++i];
+            else if (arg == "--connections" && has_value && (value = std::atol(argv[++i])) > 0)
+                options.connections = static_cast<size_t>(value);
+            else if (arg == "--requests" && has_value && (value = std::atol(argv[++i])) > 0)
+                options.requests = static_cast<size_t>(value);
+            else if (arg == "--depth" && has_value && (value = std::atol(argv[++i])) > 0)
+                options.depth = static_cast<size_t>(value);
+            else if (arg == "--sessions")
+                options.sessions = true;
+            else
+                return false;
+        }
+        return options.socket_path != nullptr;
+    }
+
+    struct load_result
+    {
+        std::vector<double> latencies_us;
+        size_t errors = 0;
+        bool failed = false;
+    };
+
+#ifndef _WIN32
+    // Sends requests over one connection, keeping up to depth of them unanswered, and times each round trip.
+    load_result run_connection(const load_options& options, const std::vector<std::string>& corpus, const size_t index)
+    {
+        load_result result;
+        const int fd = connect_unix(options.socket_path);
+        if (fd < 0)
+        {
+            result.failed = true;
+            return result;
+        }
+        line_stream stream{fd, fd, true};
+
+        const std::string session = options.sessions ? "load-" + std::to_string(index) : std::string{};
+        std::vector<clock::time_point> sent(options.requests);
+        result.latencies_us.reserve(options.requests);
+
+        size_t next = 0;
+        const auto send_next = [&]
+        {
+            std::string line = "{\"id\":" + std::to_string(next) + ",\"expression\":";
+            append_json_string(line, corpus[(index + next) % corpus.size()]);
+            if (!session.empty())
+            {
+                line += ",\"session\":";
+                append_json_string(line, session);
+            }
+            line += '}';
+            sent[next] = clock::now();
+            next++;
+            return stream.write_line(line);
+        };
+
+        while (next < std::min(options.depth, options.requests))
+        {
+            if (!send_next())
+            {
+                result.failed = true;
+                return result;
+            }
+        }
+
+        std::string response;
+        while (result.latencies_us.size() < options.requests && stream.read_line(response))
+        {
+            const auto now = clock::now();
+            size_t id = 0;
+            const size_t at = response.find("\"id\":");
+            if (at == std::string::npos)
+                break;
+            std::from_chars(response.data() + at + 5, response.data() + response.size(), id);
+            if (id >= sent.size())
+                break;
+            result.latencies_us.push_back(std::chrono::duration<double, std::micro>(now - sent[id]).count());
+            if (response.find("\"error\":") != std::string::npos)
+                result.errors++;
+
+            if (next < options.requests && !send_next())
+                break;
+        }
+
+        result.failed = result.latencies_us.size() != options.requests;
+        return result;
+    }
+#endif
+}
+
+int serve(const int argc, char* argv[])
+{
+    serve_options options;
+    if (!parse_serve_options(argc, argv, options))
+    {
+        std::cerr << "usage: tcalc serve [--socket PATH] [--workers N] [--parse-cache N] [--precision N]"
+                     " [--max-sessions N] [--session-idle SECONDS]\n";
+        return 2;
+    }
+
+    if (options.socket_path == nullptr)
+    {
+        server srv{options};
+        srv.handle(std::make_shared<line_stream>(0, 1, false));
+        srv.drain();
+        return 0;
+    }
+
+#ifdef _WIN32
+    std::cerr << "tcalc serve: --socket is not supported on Windows, use stdin and stdout\n";
+    return 1;
+#else
+    std::signal(SIGPIPE, SIG_IGN); // A client that goes away must not take the server with it
+
+    const int listener = listen_unix(options.socket_path);
+    if (listener < 0 || pipe(shutdown_pipe) != 0)
+    {
+        std::perror("tcalc serve");
+        return 1;
+    }
+    std::signal(SIGINT, request_shutdown);
+    std::signal(SIGTERM, request_shutdown);
+
+    server srv{options};
+    int status = 0;
+    while (true)
+    {
+        pollfd fds[] = {{listener, POLLIN, 0}, {shutdown_pipe[0], POLLIN, 0}};
+        if (poll(fds, 2, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            std::perror("tcalc serve");
+            status = 1;
+            break;
+        }
+        if (fds[1].revents != 0)
+            break; // Shut down cleanly, so that the caller can still write the trace
+
+        const int fd = accept(listener, nullptr, nullptr);
+        if (fd < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            std::perror("tcalc serve");
+            status = 1;
+            break;
+        }
+        srv.serve_client(std::make_shared<line_stream>(fd, fd, true));
+    }
+
+    close(listener);
+    unlink(options.socket_path);
+    srv.disconnect_all();
+    srv.drain();
+    return status;
+#endif
+}
+
+int serve_load(const int argc, char* argv[])
+{
+    load_options options;
+    if (!parse_load_options(argc, argv, options))
+    {
+        std::cerr << "usage: tcalc serve-load --socket PATH [--connections N] [--requests N] [--depth N] [--sessions]"
+                     " [--corpus FILE]\n";
+        return 2;
+    }
+
+#ifdef _WIN32
+    std::cerr << "tcalc serve-load: Unix domain sockets are not supported on Windows\n";
+    return 1;
+#else
+    std::vector<std::string> corpus;
+    if (options.corpus_path != nullptr)
+    {
+        std::ifstream in{options.corpus_path};
+        for (std::string line; std::getline(in, line);)
+        {
+            if (!line.empty())
+                corpus.push_back(std::move(line));
+        }
+    }
+    if (corpus.empty())
+        corpus = {"1+2", "2^64", "sqrt(2)", "sin(30)+cos(60)", "ln(10)/ln(2)", "(1+i)^8", "x=5", "x*3-1", "exp(1)"};
+
+    std::vector<load_result> results(options.connections);
+    std::vector<std::thread> threads;
+    const auto start = clock::now();
+    for (size_t i = 0; i < options.connections; i++)
+        threads.emplace_back([&, i] { results[i] = run_connection(options, corpus, i); });
+    for (auto& thread : threads)
+        thread.join();
+    const double seconds = std::chrono::duration<double>(clock::now() - start).count();
+
+    std::vector<double> latencies;
+    size_t errors = 0;
+    bool failed = false;
+    for (const auto& result : results)
+    {
+        latencies.insert(latencies.end(), result.latencies_us.begin(), result.latencies_us.end());
+        errors += result.errors;
+        failed |= result.failed;
+    }
+    std::ranges::sort(latencies);
+
+    std::cout << "requests:     " << latencies.size() << " on " << options.connections << " connections, depth "
+        << options.depth << '\n'
+        << "errors:       " << errors << '\n'
+        << "wall:         " << seconds << " s\n"
+        << "throughput:   " << static_cast<double>(latencies.size()) / seconds << " req/s\n"
+        << "latency (us): p50 " << percentile(latencies, 0.5) << ", p90 " << percentile(latencies, 0.9)
+        << ", p99 " << percentile(latencies, 0.99) << ", p99.9 " << percentile(latencies, 0.999)
+        << ", max " << (latencies.empty() ? 0 : latencies.back()) << '\n';
+
+    if (failed)
+        std::cerr << "tcalc serve-load: some connections failed or closed early\n";
+    return failed ? 1 : 0;
+#endif
+}
@@ -0,0 +1,14 @@
+#ifndef TCALC_SERVE_H
+#define TCALC_SERVE_H
+
+// Long-running server: reads JSON-lines requests from a Unix domain socket or stdin and answers each with one JSON
+// line. Requests are evaluated concurrently by a worker pool that keeps one warm evaluator per session. On SIGINT or
+// SIGTERM the socket server stops accepting and reading, answers the requests it has read and returns 0, so that
+// --trace is still written.
+int serve(int argc, char* argv[]);
+
+// Load generator for serve: keeps a number of pipelined requests in flight on several connections and reports
+// throughput and latency percentiles.
+int serve_load(int argc, char* argv[]);
+
+#endif // TCALC_SERVE_H
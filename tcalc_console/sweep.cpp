@@ -0,0 +1,362 @@
+#include "sweep.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <format>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "tc_evaluator.h"
+#include "tc_lexer.h"
+#include "tc_parser.h"
+
+namespace
+{
+    using clock = std::chrono::steady_clock;
+
+    struct sweep_options
+    {
+        long max_bits = 1000000;
+        double min_time_ms = 20;
+        double max_call_ms = 2000;
+        long fit_from = 4096;
+        double slack = 0.5;
+        double kink = 0.5;
+        tcalc::angle_unit unit = tcalc::angle_unit::degrees;
+        std::vector<std::string> only;
+    };
+
+    struct point
+    {
+        long bits;
+        double ns;
+    };
+
+    struct sweep_case
+    {
+        std::string name; // Builtin name or operator symbol
+        tcalc::fn_arity_t arity;
+        bool complex;
+        std::vector<std::string> sources; // Tried in order at the first precision, until one evaluates without error
+        std::string source;
+        std::vector<point> points;
+        bool done = false;
+        std::string error;
+    };
+
+    // 53 bits is a double, then every power of two up to the largest precision
+    std::vector<long> sweep_precisions(const long max_bits)
+    {
+        std::vector<long> bits{53};
+        for (long p = 128; p < max_bits; p *= 2)
+            bits.push_back(p);
+        if (max_bits > 53)
+            bits.push_back(max_bits);
+        return bits;
+    }
+
+    std::string call_source(const std::string_view name, const tcalc::fn_arity_t arity, const std::string_view first)
+    {
+        std::string source = std::format("{}({}", name, first);
+        for (tcalc::fn_arity_t i = 1; i < arity; i++)
+            source += ",b";
+        source += ')';
+        return source;
+    }
+
+    // Arguments are a and b, with every significand bit in use so that the cost is that of a full-precision
+    // operation. Real arguments fall back to c, which is above 1, for the functions that are real only outside
+    // [-1, 1]; complex arguments have non-zero imaginary parts and take the complex paths.
+    std::vector<sweep_case> make_cases(const sweep_options& options)
+    {
+        std::vector<sweep_case> cases;
+        const auto add = [&](const std::string& name, const tcalc::fn_arity_t arity, std::vector<std::string> sources)
+        {
+            if (!options.only.empty() && std::ranges::find(options.only, name) == options.only.end())
+                return;
+            for (const bool complex : {false, true})
+                cases.push_back({name, arity, complex, sources, {}, {}, false, {}});
+        };
+
+        for (const std::string op : {"+", "-", "*", "/", "^"})
+            add(op, 2, {"a" + op + "b", "c" + op + "b"});
+        add("√", 2, {"b√a", "b√c"});
+        for (const auto& [name, arity] : tcalc::evaluator::builtin_signatures())
+            add(std::string{name}, arity, {call_source(name, arity, "a"), call_source(name, arity, "c")});
+        return cases;
+    }
+
+    tcalc::evaluator make_evaluator(const long bits, const bool complex, const tcalc::angle_unit unit)
+    {
+        tcalc::evaluator evaluator{bits};
+        evaluator.complex_mode(complex);
+        evaluator.trig_unit(unit);
+
+        const std::initializer_list<const char*> real = {"a=pi/5", "b=e/3", "c=1+pi/5"};
+        const std::initializer_list<const char*> imaginary = {"a=pi/5+1i*e/3", "b=e/3-1i*pi/7", "c=1+pi/5+1i*e/3"};
+        for (const auto* assignment : complex ? imaginary : real)
+        {
+            tcalc::parser parser{tcalc::lexer::borrowing(assignment, true), bits};
+            auto result = evaluator.evaluate(parser.parse_expression());
+            evaluator.commit_result(result.value());
+        }
+        return evaluator;
+    }
+
+    std::optional<tcalc::arithmetic_expression> parse_arithmetic(const std::string& source, const long bits)
+    {
+        tcalc::parser parser{tcalc::lexer::borrowing(source, true), bits};
+        auto expr = parser.parse_expression();
+        if (!parser.diagnostic_bag().empty() || !std::holds_alternative<tcalc::arithmetic_expression>(expr))
+            return std::nullopt;
+        return std::get<tcalc::arithmetic_expression>(std::move(expr));
+    }
+
+    double elapsed_ns(const tcalc::evaluator& evaluator, const tcalc::arithmetic_expression& expr, const uint64_t calls)
+    {
+        const auto start = clock::now();
+        for (uint64_t i = 0; i < calls; i++)
+            (void)evaluator.evaluate_arithmetic(expr);
+        return std::chrono::duration<double, std::nano>(clock::now() - start).count();
+    }
+
+    // Nanoseconds per evaluation: the fastest of three batches, with enough calls per batch to be timed reliably. The
+    // caller has evaluated once already, so caches such as MPFR's constants are filled.
+    double time_per_call(const tcalc::evaluator& evaluator, const tcalc::arithmetic_expression& expr,
+                         const double min_batch_ns)
+    {
+        uint64_t calls = 1;
+        double batch = elapsed_ns(evaluator, expr, calls);
+        while (batch < min_batch_ns)
+        {
+            const double estimate = min_batch_ns / std::max(batch / static_cast<double>(calls), 1.0);
+            calls = std::max(calls * 2, static_cast<uint64_t>(estimate * 1.2));
+            batch = elapsed_ns(evaluator, expr, calls);
+        }
+
+        double best = batch;
+        for (int i = 0; i < 2 && batch < min_batch_ns * 4; i++)
+            best = std::min(best, elapsed_ns(evaluator, expr, calls));
+        return best / static_cast<double>(calls);
+    }
+
+    // Exponent of the precision between two points: 1 for linear cost, 2 for quadratic.
+    double slope(const point& from, const point& to)
+    {
+        return std::log(to.ns / from.ns) / std::log(static_cast<double>(to.bits) / static_cast<double>(from.bits));
+    }
+
+    // Least squares fit of log(time) against log(bits) over the points from the given precision on, where the
+    // constant cost of an evaluation no longer hides the scaling. NaN with fewer than two such points.
+    double fit_exponent(const std::vector<point>& points, const long from_bits)
+    {
+        double n = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+        for (const auto& [bits, ns] : points)
+        {
+            if (bits < from_bits)
+                continue;
+            const double x = std::log(static_cast<double>(bits));
+            const double y = std::log(ns);
+            n++;
+            sx += x;
+            sy += y;
+            sxx += x * x;
+            sxy += x * y;
+        }
+        if (n < 2)
+            return std::numeric_limits<double>::quiet_NaN();
+        return (n * sxy - sx * sy) / (n * sxx - sx * sx);
+    }
+
+    // Precisions where the slope jumps, which is where MPFR, MPC or GMP switch algorithms or thresholds. Below 256
+    // bits the constant cost of an evaluation dominates and the slopes are noise.
+    std::string kinks(const std::vector<point>& points, const double threshold)
+    {
+        std::string result;
+        for (size_t i = 2; i < points.size(); i++)
+        {
+            if (points[i - 2].bits < 256)
+                continue;
+            const double before = slope(points[i - 2], points[i - 1]);
+            const double after = slope(points[i - 1], points[i]);
+            if (std::abs(after - before) < threshold)
+                continue;
+            if (!result.empty())
+                result += ", ";
+            result += std::format("{:.2f}->{:.2f} at {}", before, after, points[i - 1].bits);
+        }
+        return result;
+    }
+
+    const sweep_case* find_case(const std::vector<sweep_case>& cases, const std::string_view name, const bool complex)
+    {
+        const auto it = std::ranges::find_if(cases, [&](const sweep_case& c)
+        {
+            return c.name == name && c.complex == complex && c.error.empty();
+        });
+        return it != cases.end() ? &*it : nullptr;
+    }
+
+    // Builtins are expected to cost at most a polylogarithmic factor more than a multiplication at the same
+    // precision, which the slack on the exponent allows for. Faster growth than that is flagged.
+    void print_summary(const std::vector<sweep_case>& cases, const sweep_options& options)
+    {
+        std::cerr << std::format("\n{:<8} {:<5} {:<8} {:>8} {:>12}  {}\n", "name", "arity", "domain", "exponent",
+                                 "x mul at max", "slope changes (bits)");
+        for (const auto& c : cases)
+        {
+            const char* domain = c.complex ? "complex" : "real";
+            if (!c.error.empty())
+            {
+                std::cerr << std::format("{:<8} {:<5} {:<8} {:>8}\n", c.name, c.arity, domain, c.error);
+                continue;
+            }
+
+            const double exponent = fit_exponent(c.points, options.fit_from);
+            const sweep_case* mul = find_case(cases, "*", c.complex);
+            std::string relative = "-";
+            if (mul != nullptr && !c.points.empty())
+            {
+                const auto at = std::ranges::find(mul->points, c.points.back().bits, &point::bits);
+                if (at != mul->points.end())
+                    relative = std::format("{:.3g}", c.points.back().ns / at->ns);
+            }
+
+            std::string flag;
+            const double expected = mul != nullptr ? fit_exponent(mul->points, options.fit_from) : 1.5;
+            if (!std::isnan(exponent) && !std::isnan(expected) && exponent > expected + options.slack)
+                flag = std::format("  SLOW: exponent above {:.2f}", expected + options.slack);
+            if (c.done && !c.points.empty() && c.points.back().bits < options.max_bits)
+                flag += std::format("  stopped after {} bits", c.points.back().bits);
+
+            std::cerr << std::format("{:<8} {:<5} {:<8} {:>8.2f} {:>12}  {}{}\n", c.name, c.arity, domain, exponent,
+                                     relative, kinks(c.points, options.kink), flag);
+        }
+    }
+
+    bool parse_options(const int argc, char* argv[], sweep_options& options)
+    {
+        for (int i = 2; i < argc; i++)
+        {
+            const std::string_view arg = argv[i];
+            if (i + 1 >= argc)
+                return false;
+            if (arg == "--max-bits")
+                options.max_bits = std::atol(argv[++i]);
+            else if (arg == "--min-time-ms")
+                options.min_time_ms = std::atof(argv[++i]);
+            else if (arg == "--max-call-ms")
+                options.max_call_ms = std::atof(argv[++i]);
+            else if (arg == "--fit-from")
+                options.fit_from = std::atol(argv[++i]);
+            else if (arg == "--slack")
+                options.slack = std::atof(argv[++i]);
+            else if (arg == "--kink")
+                options.kink = std::atof(argv[++i]);
+            else if (arg == "--only")
+            {
+                std::istringstream names{argv[++i]};
+                for (std::string name; std::getline(names, name, ',');)
+                    options.only.push_back(name);
+            }
+            else if (arg == "--unit")
+            {
+                const std::string_view unit = argv[++i];
+                if (unit == "rad")
+                    options.unit = tcalc::angle_unit::radians;
+                else if (unit == "deg")
+                    options.unit = tcalc::angle_unit::degrees;
+                else if (unit == "grad")
+                    options.unit = tcalc::angle_unit::gradians;
+                else
+                    return false;
+            }
+            else
+                return false;
+        }
+        return options.max_bits >= 53 && options.min_time_ms > 0 && options.max_call_ms > 0;
+    }
+}
+
+int sweep(const int argc, char* argv[])
+{
+    sweep_options options;
+    if (!parse_options(argc, argv, options))
+    {
+        std::cerr << "usage: tcalc sweep [--max-bits N] [--min-time-ms T] [--max-call-ms T] [--unit rad|deg|grad]"
+            " [--only name,...] [--fit-from N] [--slack S] [--kink K]\n";
+        return 2;
+    }
+
+    auto cases = make_cases(options);
+    if (cases.empty())
+    {
+        std::cerr << "tcalc: no builtin or operator matches --only\n";
+        return 2;
+    }
+
+    std::cout << "name,arity,domain,bits,ns_per_call,slope\n";
+    for (const long bits : sweep_precisions(options.max_bits))
+    {
+        const tcalc::evaluator real = make_evaluator(bits, false, options.unit);
+        const tcalc::evaluator complex = make_evaluator(bits, true, options.unit);
+        for (auto& c : cases)
+        {
+            if (c.done)
+                continue;
+
+            const tcalc::evaluator& evaluator = c.complex ? complex : real;
+            std::optional<tcalc::arithmetic_expression> expr;
+            if (c.source.empty())
+            {
+                for (const auto& source : c.sources)
+                {
+                    expr = parse_arithmetic(source, bits);
+                    if (expr && !evaluator.evaluate_arithmetic(*expr).is_error())
+                    {
+                        c.source = source;
+                        break;
+                    }
+                    expr.reset();
+                }
+            }
+            else if ((expr = parse_arithmetic(c.source, bits)))
+            {
+                const auto first = clock::now();
+                const bool failed = evaluator.evaluate_arithmetic(*expr).is_error();
+                const std::chrono::duration<double, std::milli> first_ms = clock::now() - first;
+                if (failed || first_ms.count() > options.max_call_ms)
+                    expr.reset();
+            }
+
+            if (!expr)
+            {
+                if (c.points.empty())
+                    c.error = "error";
+                c.done = true;
+                continue;
+            }
+
+            const point p{bits, time_per_call(evaluator, *expr, options.min_time_ms * 1e6 / 3)};
+            const char* domain = c.complex ? "complex" : "real";
+            std::cout << std::format("{},{},{},{},{:.1f},", c.name, c.arity, domain, bits, p.ns);
+            if (!c.points.empty())
+                std::cout << std::format("{:.3f}", slope(c.points.back(), p));
+            std::cout << std::endl;
+
+            c.points.push_back(p);
+            if (p.ns > options.max_call_ms * 1e6)
+                c.done = true;
+        }
+    }
+
+    print_summary(cases, options);
+    return 0;
+}
@@ -0,0 +1,8 @@
+#ifndef TCALC_SWEEP_H
+#define TCALC_SWEEP_H
+
+// Times every builtin and binary operator over a sweep of precisions, with real and complex arguments, and writes the
+// timings as CSV. A summary of the fitted scaling, the precisions where it changes and the outliers goes to stderr.
+int sweep(int argc, char* argv[]);
+
+#endif // TCALC_SWEEP_H
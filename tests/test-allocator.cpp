@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+#include "tc_allocator.h"
+#include "tc_evaluator.h"
+#include "tc_lexer.h"
+#include "tc_parser.h"
+
+constexpr long precision = 64;
+
+namespace
+{
+    // Installed before the first test creates a number. These tests run in their own executable, so the pooled
+    // allocator replaces GMP's for them alone.
+    class allocator_environment final : public testing::Environment
+    {
+    public:
+        void SetUp() override
+        {
+            tcalc::install_allocator();
+        }
+    };
+
+    [[maybe_unused]]
+    testing::Environment* const environment = testing::AddGlobalTestEnvironment(new allocator_environment);
+
+    tcalc::expression parse(const std::string_view input)
+    {
+        tcalc::parser parser{tcalc::lexer{std::string{input}, true}, precision};
+        auto expr = parser.parse_expression();
+        EXPECT_TRUE(parser.diagnostic_bag().empty());
+        return expr;
+    }
+
+    bool same_result(const tcalc::evaluator::result_type& a, const tcalc::evaluator::result_type& b)
+    {
+        if (a.index() != b.index())
+            return false;
+        if (const auto* asgn = std::get_if<tcalc::assign_result>(&a))
+            return asgn->value == std::get<tcalc::assign_result>(b).value;
+        if (const auto* num = std::get_if<tcalc::number>(&a))
+            return *num == std::get<tcalc::number>(b);
+        return std::get<bool>(a) == std::get<bool>(b);
+    }
+}
+
+TEST(Allocator, Installed)
+{
+    ASSERT_TRUE(tcalc::allocator_installed());
+    ASSERT_NO_THROW(tcalc::install_allocator());
+}
+
+TEST(Allocator, FreeListsReuseBlocks)
+{
+    const auto before = tcalc::get_allocator_stats();
+    for (int i = 0; i < 100; i++)
+    {
+        tcalc::number a{256};
+        a.set(i, 0);
+        const tcalc::number b = a;
+    }
+    const auto after = tcalc::get_allocator_stats();
+
+    ASSERT_GE(after.free_list_hits - before.free_list_hits, 190);
+    ASSERT_EQ(after.bytes_allocated - before.bytes_allocated, after.bytes_freed - before.bytes_freed);
+}
+
+TEST(Allocator, ArenaResultsOutliveTheArena)
+{
+    tcalc::evaluator pooled{precision};
+    tcalc::evaluator arena{precision};
+    arena.arena_mode(true);
+
+    const auto before = tcalc::get_allocator_stats();
+    for (const auto* input : {"x=sqrt(2)*3", "sin(30)+x^2", "Ans*pi", "x>4", "Ans+exp(1)"})
+    {
+        const auto expr = parse(input);
+        auto expected = pooled.evaluate(expr);
+        auto actual = arena.evaluate(expr);
+        ASSERT_FALSE(expected.is_error());
+        ASSERT_FALSE(actual.is_error());
+        ASSERT_TRUE(same_result(expected.value(), actual.value())) << input;
+        pooled.commit_result(expected.value());
+        arena.commit_result(actual.value());
+    }
+    const auto after = tcalc::get_allocator_stats();
+
+    ASSERT_EQ(after.arena_resets - before.arena_resets, 5);
+    ASSERT_GT(after.arena_bytes_allocated, before.arena_bytes_allocated);
+}
+
+TEST(Allocator, BlocksCrossThreads)
+{
+    std::vector<tcalc::number> numbers;
+    std::thread producer{[&numbers]
+    {
+        tcalc::evaluator evaluator{precision};
+        evaluator.arena_mode(true);
+        for (int i = 0; i < 50; i++)
+        {
+            auto result = evaluator.evaluate(parse("sqrt(2)+cos(60)"));
+            numbers.push_back(std::get<tcalc::number>(result.value()));
+        }
+    }};
+    producer.join();
+
+    // The producer has exited, so these blocks are freed into this thread's lists
+    const tcalc::evaluator evaluator{precision};
+    const auto expected = evaluator.evaluate(parse("sqrt(2)+cos(60)"));
+    for (const auto& n : numbers)
+        ASSERT_EQ(std::get<tcalc::number>(expected.value()), n);
+    numbers.clear();
+
+    const auto stats = tcalc::get_allocator_stats();
+    ASSERT_GE(stats.arena_resets, 50);
+}
@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <sstream>
+
+#include "tc_evaluator.h"
+#include "tc_lexer.h"
+#include "tc_parser.h"
+
+constexpr long precision = 64;
+
+static void run(tcalc::evaluator& evaluator, const std::string_view input)
+{
+    tcalc::parser parser{tcalc::lexer{std::string{input}, true}, precision};
+    const auto expr = parser.parse_expression();
+    ASSERT_TRUE(parser.diagnostic_bag().empty());
+    auto result = evaluator.evaluate(expr);
+    if (!result.is_error())
+        evaluator.commit_result(result.value());
+}
+
+template<class Name>
+static uint64_t count_of(const std::vector<std::pair<Name, uint64_t>>& counters, const std::string_view name)
+{
+    const auto it = std::ranges::find_if(counters, [name](const auto& entry) { return entry.first == name; });
+    return it == counters.end() ? 0 : it->second;
+}
+
+TEST(EvaluatorStats, EmptyWhenDisabled)
+{
+    if (tcalc::evaluator::stats_enabled)
+        GTEST_SKIP() << "built with TCALC_STATS";
+
+    tcalc::evaluator evaluator{precision};
+    run(evaluator, "sin(30)+1");
+    const auto stats = evaluator.stats();
+    ASSERT_TRUE(stats.operations.empty());
+    ASSERT_TRUE(stats.phases.empty());
+    ASSERT_EQ(stats.number_operations, 0);
+}
+
+TEST(EvaluatorStats, CountsOperationsAndLookups)
+{
+    if (!tcalc::evaluator::stats_enabled)
+        GTEST_SKIP() << "built without TCALC_STATS";
+
+    tcalc::evaluator evaluator{precision};
+    run(evaluator, "x=2");
+    run(evaluator, "sin(x)+cos(pi)*-x");
+    run(evaluator, "y");
+    run(evaluator, "1/0");
+    run(evaluator, "x>1");
+
+    const auto stats = evaluator.stats();
+    ASSERT_EQ(count_of(stats.operations, "literal"), 4);
+    ASSERT_EQ(count_of(stats.operations, "variable"), 5);
+    ASSERT_EQ(count_of(stats.operations, "call"), 2);
+    ASSERT_EQ(count_of(stats.operations, "binary:plus"), 1);
+    ASSERT_EQ(count_of(stats.operations, "binary:multiply"), 1);
+    ASSERT_EQ(count_of(stats.operations, "binary:divide"), 1);
+    ASSERT_EQ(count_of(stats.operations, "unary:minus"), 1);
+    ASSERT_EQ(count_of(stats.builtin_calls, "sin"), 1);
+    ASSERT_EQ(count_of(stats.builtin_calls, "cos"), 1);
+    ASSERT_EQ(count_of(stats.builtin_calls, "tan"), 0);
+
+    ASSERT_EQ(stats.constant_lookups, 1);
+    ASSERT_EQ(stats.variable_lookups, 3);
+    ASSERT_EQ(stats.undefined_lookups, 1);
+    ASSERT_GT(stats.number_copies, 0);
+    ASSERT_GT(stats.number_operations, 0);
+
+    ASSERT_EQ(stats.phases.size(), 5);
+    ASSERT_EQ(stats.phases[static_cast<size_t>(tcalc::evaluator_phase::arithmetic)].calls, 6);
+    ASSERT_EQ(stats.phases[static_cast<size_t>(tcalc::evaluator_phase::boolean)].calls, 1);
+    ASSERT_EQ(stats.phases[static_cast<size_t>(tcalc::evaluator_phase::assignment)].calls, 1);
+    ASSERT_EQ(stats.phases[static_cast<size_t>(tcalc::evaluator_phase::function_call)].calls, 2);
+    ASSERT_EQ(stats.phases[static_cast<size_t>(tcalc::evaluator_phase::commit)].calls, 3);
+}
+
+TEST(EvaluatorStats, CountsFiniteCheckFailures)
+{
+    if (!tcalc::evaluator::stats_enabled)
+        GTEST_SKIP() << "built without TCALC_STATS";
+
+    tcalc::evaluator evaluator{precision};
+    evaluator.complex_mode(false);
+    run(evaluator, "10^10^10^10");
+    run(evaluator, "(-8)^(1/3)");
+
+    const auto stats = evaluator.stats();
+    ASSERT_EQ(count_of(stats.finite_check_failures, "overflow"), 1);
+}
+
+TEST(EvaluatorStats, TakeResetsAndCopiesStartFromZero)
+{
+    if (!tcalc::evaluator::stats_enabled)
+        GTEST_SKIP() << "built without TCALC_STATS";
+
+    tcalc::evaluator evaluator{precision};
+    run(evaluator, "1+2");
+
+    const tcalc::evaluator copy = evaluator;
+    ASSERT_TRUE(copy.stats().operations.empty());
+
+    const auto taken = evaluator.take_stats();
+    ASSERT_EQ(count_of(taken.operations, "binary:plus"), 1);
+    ASSERT_TRUE(evaluator.stats().operations.empty());
+
+    run(evaluator, "3*4");
+    const auto after = evaluator.stats();
+    ASSERT_EQ(count_of(after.operations, "binary:plus"), 0);
+    ASSERT_EQ(count_of(after.operations, "binary:multiply"), 1);
+}
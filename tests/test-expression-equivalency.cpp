@@ -86,3 +86,11 @@ INSTANTIATE_TEST_SUITE_P(
     testing::Values(
         std::pair{"acoth(5)", "ln(2/(5-1)+1)/2"}
     ));
+
+INSTANTIATE_TEST_SUITE_P(
+    DegreeSineOperations, ExpressionEquivalency,
+    testing::Values(
+        std::pair{"sin(60)", "sqrt(3)/2"},
+        std::pair{"cos(210)", "-sqrt(3)/2"},
+        std::pair{"sin(1)", "sin((pi/180)rad)"}
+    ));
@@ -80,4 +80,119 @@ INSTANTIATE_TEST_SUITE_P(
         std::pair{"asech(sech(30))", "30"},
         std::pair{"acsch(csch(30))", "30"},
         std::pair{"acoth(coth(1))", "1"}
-        ));
\ No newline at end of file
+        ));
+INSTANTIATE_TEST_SUITE_P(
+    ExactTrigonometricValues, ExpressionEvaluation,
+    testing::Values(
+        std::pair{"tan(45)", "1"},
+        std::pair{"tan(180)", "0"},
+        std::pair{"sec(60)", "2"},
+        std::pair{"sec(180)", "-1"},
+        std::pair{"csc(30)", "2"},
+        std::pair{"csc(270)", "-1"},
+        std::pair{"cot(45)", "1"},
+        std::pair{"cot(90)", "0"},
+        std::pair{"cot(270)", "0"}
+        ));
+
+INSTANTIATE_TEST_SUITE_P(
+    SpecialAngles, ExpressionEvaluation,
+    testing::Values(
+        std::pair{"sin(30)", "0.5"},
+        std::pair{"sin(-150)", "-0.5"},
+        std::pair{"cos(420)", "0.5"},
+        std::pair{"sin(36000090)", "1"},
+        std::pair{"asin(0.5)", "30"},
+        std::pair{"acos(-0.5)", "120"},
+        std::pair{"atan(-1)", "-45"},
+        std::pair{"arg(-1)", "180"},
+        std::pair{"arg(1+i)", "45"},
+        std::pair{"sin(100grad)", "1"}
+        ));
+
+INSTANTIATE_TEST_SUITE_P(
+    LongLiterals, ExpressionEvaluation,
+    testing::Values(
+        std::pair{"1" + std::string(20000, '0') + "/10^20000", std::string{"1"}},
+        std::pair{"0." + std::string(20000, '0') + "25*10^20001", std::string{"2.5"}},
+        std::pair{std::string{"1'000'000'000'000'000'000/10^18"}, std::string{"1"}},
+        std::pair{std::string{"12345678901234567.5e-16"}, std::string{"1.23456789012345675"}}
+    ));
+
+TEST(ParserReset, ReusesParserAndOutput)
+{
+    tcalc::evaluator evaluator{precision};
+    tcalc::parser parser{tcalc::lexer::borrowing({}, true), precision};
+    tcalc::expression expr;
+
+    const std::pair<std::string_view, std::string_view> cases[] = {
+        {"2+2*3", "8"},
+        {"sqrt(16)-1", "3"},
+        {"1+", ""},
+        {"2^10", "1024"},
+    };
+
+    for (const auto& [input, expected] : cases)
+    {
+        parser.reset(input);
+        parser.parse_expression(expr);
+
+        if (expected.empty())
+        {
+            ASSERT_FALSE(parser.diagnostic_bag().empty());
+            continue;
+        }
+        ASSERT_TRUE(parser.diagnostic_bag().empty());
+
+        auto result = evaluator.evaluate(expr);
+        ASSERT_FALSE(result.is_error());
+        ASSERT_EQ(std::get<tcalc::number>(result.value()).string(), expected);
+    }
+
+    const auto* tokens = std::get<tcalc::arithmetic_expression>(expr).tokens.data();
+    parser.reset("1+1");
+    parser.parse_expression(expr);
+    ASSERT_EQ(std::get<tcalc::arithmetic_expression>(expr).tokens.data(), tokens);
+}
+
+static std::string evaluate_to_string(const tcalc::evaluator& evaluator, const std::string& input)
+{
+    tcalc::parser parser{tcalc::lexer{input, true}, precision};
+    auto result = evaluator.evaluate(parser.parse_expression());
+    if (result.is_error())
+        return std::string{tcalc::eval_error_type_name(result.error().type)};
+    return std::get<tcalc::number>(result.value()).string();
+}
+
+TEST(UserFunctions, OverlayBuiltins)
+{
+    tcalc::evaluator evaluator{precision};
+    const tcalc::evaluator other{precision};
+
+    evaluator.define_function("twice", 1, [](tcalc::evaluator::stack& stack, const tcalc::evaluator&)
+    {
+        stack.back().mul(stack.back(), 2);
+        return tcalc::eval_error_type::none;
+    });
+    evaluator.define_function("sqrt", 2, [](tcalc::evaluator::stack& stack, const tcalc::evaluator&)
+    {
+        stack.pop_back();
+        return tcalc::eval_error_type::none;
+    });
+
+    ASSERT_EQ(evaluate_to_string(evaluator, "twice(21)"), "42");
+    ASSERT_EQ(evaluate_to_string(evaluator, "sqrt(16)"), "4");
+    ASSERT_EQ(evaluate_to_string(evaluator, "sqrt(16, 3)"), "16");
+    ASSERT_EQ(evaluate_to_string(evaluator, "twice(1, 2)"), "bad_arity");
+    ASSERT_EQ(evaluate_to_string(other, "twice(21)"), "undefined_function");
+}
+
+// Evaluated during static initialization, in whatever order relative to the library's own translation units
+static const tcalc::symbol early_user_symbol{"early_user_symbol"};
+static const std::string early_result = evaluate_to_string(tcalc::evaluator{precision}, "sqrt(16)+pi-π");
+
+TEST(StaticInitialization, BuiltinsWorkBeforeMain)
+{
+    ASSERT_EQ(early_result, "4");
+    ASSERT_GT(early_user_symbol.id(), tcalc::symbol{"sqrt"}.id());
+}
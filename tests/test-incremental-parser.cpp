@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+
+#include <format>
+#include <random>
+
+#include "tc_incremental_parser.h"
+#include "tc_lexer.h"
+#include "tc_parser.h"
+
+constexpr long precision = 64;
+
+static std::string describe(const tcalc::arithmetic_expression& expr)
+{
+    std::string str = std::format("<{}-{}>", expr.position.start_index, expr.position.end_index);
+    for (const auto& op : expr.tokens)
+        str += tcalc::op_to_string(op) + ' ';
+    return str;
+}
+
+static std::string describe(const std::vector<tcalc::expression>& exprs, const std::vector<tcalc::diagnostic>& diags)
+{
+    std::string str;
+    for (const auto& expr : exprs)
+    {
+        if (const auto* arith = std::get_if<tcalc::arithmetic_expression>(&expr))
+            str += describe(*arith);
+        else if (const auto* asgn = std::get_if<tcalc::assignment_expression>(&expr))
+            str += std::format("{}={} <{}-{}>", asgn->variable.name(), describe(asgn->expression),
+                               asgn->position.start_index, asgn->position.end_index);
+        else if (const auto* boolean = std::get_if<tcalc::boolean_expression>(&expr))
+            str += std::format("{} {} {} <{}-{}>", describe(boolean->lhs), tcalc::token_kind_name(boolean->kind),
+                               describe(boolean->rhs), boolean->position.start_index, boolean->position.end_index);
+        str += '\n';
+    }
+    for (const auto& diag : diags)
+        str += std::format("!{} {}-{}\n", tcalc::diagnostic_type_name(diag.type()), diag.start_index(),
+                           diag.end_index());
+    return str;
+}
+
+static std::string full_parse(const std::string& text)
+{
+    tcalc::parser p{tcalc::lexer::borrowing(text, true), precision};
+    const auto exprs = p.parse_all();
+    return describe(exprs, p.diagnostic_bag());
+}
+
+TEST(IncrementalParser, EditReparsesOnlyTouchedExpressions)
+{
+    std::string text;
+    for (int i = 0; i < 100; i++)
+        text += std::format("x{} = {} * 2\n", i, i);
+
+    tcalc::incremental_parser doc{text, true, precision};
+    ASSERT_EQ(doc.expression_count(), 100);
+
+    const size_t at = doc.text().find("50 * 2");
+    ASSERT_LE(doc.edit(at, at + 2, "1234"), 2);
+    ASSERT_EQ(describe(doc.expressions(), doc.diagnostics()), full_parse(doc.text()));
+}
+
+TEST(IncrementalParser, RandomEditsMatchFullParse)
+{
+    const std::string_view pieces[] = {
+        "1", "23", "4.5", "e", "x", "sin", "(", ")", "+", "-", "*", "/", "^", "=", "<", "<=", "\n", ":", " ", ",",
+        "2e", "+3", "√", "²", "°", "$", "ab", "0x1F", "!",
+    };
+
+    std::mt19937 rand{1234};
+    std::uniform_int_distribution<size_t> piece_dist{0, std::size(pieces) - 1};
+
+    for (int doc_ix = 0; doc_ix < 50; doc_ix++)
+    {
+        std::string text;
+        for (int i = 0; i < 60; i++)
+            text += pieces[piece_dist(rand)];
+
+        tcalc::incremental_parser doc{text, true, precision};
+        ASSERT_EQ(describe(doc.expressions(), doc.diagnostics()), full_parse(doc.text()));
+
+        for (int edit_ix = 0; edit_ix < 40; edit_ix++)
+        {
+            const size_t size = doc.text().size();
+            size_t start = std::uniform_int_distribution<size_t>{0, size}(rand);
+            size_t end = std::min(size, start + std::uniform_int_distribution<size_t>{0, 4}(rand));
+
+            // Keep edits on UTF-8 character boundaries, as an editor would
+            while (start > 0 && (static_cast<unsigned char>(doc.text()[start]) & 0xC0) == 0x80)
+                start--;
+            while (end < size && (static_cast<unsigned char>(doc.text()[end]) & 0xC0) == 0x80)
+                end++;
+
+            std::string replacement;
+            const int count = std::uniform_int_distribution{0, 2}(rand);
+            for (int i = 0; i < count; i++)
+                replacement += pieces[piece_dist(rand)];
+
+            doc.edit(start, end, replacement);
+            ASSERT_EQ(describe(doc.expressions(), doc.diagnostics()), full_parse(doc.text()))
+                << "after replacing " << start << '-' << end << " with \"" << replacement << "\" in \"" << doc.text()
+                << '"';
+        }
+    }
+}
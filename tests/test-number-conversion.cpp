@@ -0,0 +1,51 @@
+#include <gtest/gtest.h>
+
+#include <cfloat>
+#include <cmath>
+#include <limits>
+
+#include "tc_number.h"
+
+TEST(NumberConversion, DoublesRoundTripExactly)
+{
+    const double denormal = std::numeric_limits<double>::denorm_min();
+    for (const double x : {0.1, -2.5, DBL_MAX, DBL_MIN, denormal, std::nextafter(1.0, 2.0)})
+    {
+        tcalc::number n{53};
+        n.set_double(x);
+        EXPECT_TRUE(n.is_real());
+        EXPECT_EQ(n.real_double(), x);
+        EXPECT_EQ(n.real_long_double(), static_cast<long double>(x));
+    }
+
+    tcalc::number wide{LDBL_MANT_DIG};
+    const long double third = 1.0L / 3;
+    wide.set_long_double(third);
+    EXPECT_EQ(wide.real_long_double(), third);
+}
+
+TEST(NumberConversion, RoundsToNearest)
+{
+    tcalc::number third{256};
+    third.set(1);
+    third.div(third, 3);
+    EXPECT_EQ(third.real_double(), 1.0 / 3);
+
+    tcalc::number narrow{8};
+    narrow.set_double(1.0 + std::ldexp(1.0, -10));
+    EXPECT_EQ(narrow.real_double(), 1.0);
+}
+
+TEST(NumberConversion, ScalesByPowersOfTwoBeyondLongDouble)
+{
+    tcalc::number x{2000};
+    x.set_double(0.75);
+    EXPECT_EQ(x.real_exponent(), 0);
+
+    x.mul_2exp(x, -100000); // Far below the smallest long double
+    EXPECT_EQ(x.real_exponent(), -100000);
+    EXPECT_EQ(x.real_long_double(), 0);
+
+    x.mul_2exp(x, 100002);
+    EXPECT_EQ(x.real_double(), 3.0);
+}
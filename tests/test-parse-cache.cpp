@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include "tc_evaluator.h"
+#include "tc_parse_cache.h"
+
+constexpr long precision = 64;
+
+TEST(ParseCache, HitsShareResult)
+{
+    tcalc::parse_cache cache{4};
+
+    const auto first = cache.parse("2+2", true, precision);
+    const auto second = cache.parse("2+2", true, precision);
+    ASSERT_EQ(first, second);
+    ASSERT_EQ(first->expressions.size(), 1);
+    ASSERT_TRUE(first->diagnostics.empty());
+
+    tcalc::evaluator evaluator{precision};
+    auto result = evaluator.evaluate(second->expressions[0]);
+    ASSERT_FALSE(result.is_error());
+    ASSERT_EQ(std::get<tcalc::number>(result.value()).string(), "4");
+
+    const auto stats = cache.stats();
+    ASSERT_EQ(stats.hits, 1);
+    ASSERT_EQ(stats.misses, 1);
+    ASSERT_EQ(stats.size, 1);
+}
+
+TEST(ParseCache, SettingsArePartOfKey)
+{
+    tcalc::parse_cache cache{4};
+
+    const auto comma = cache.parse("1,5", true, precision);
+    const auto semicolon = cache.parse("1,5", false, precision);
+    const auto precise = cache.parse("1,5", true, precision * 2);
+    ASSERT_NE(comma, semicolon);
+    ASSERT_NE(comma, precise);
+    ASSERT_FALSE(comma->diagnostics.empty());
+    ASSERT_TRUE(semicolon->diagnostics.empty());
+    ASSERT_EQ(cache.stats().misses, 3);
+}
+
+TEST(ParseCache, EvictsLeastRecentlyUsed)
+{
+    tcalc::parse_cache cache{2};
+
+    const auto a = cache.parse("1", true, precision);
+    cache.parse("2", true, precision);
+    cache.parse("1", true, precision); // "2" is now least recently used
+    cache.parse("3", true, precision);
+
+    ASSERT_EQ(cache.parse("1", true, precision), a);
+    auto stats = cache.stats();
+    ASSERT_EQ(stats.evictions, 1);
+    ASSERT_EQ(stats.size, 2);
+
+    cache.parse("2", true, precision);
+    stats = cache.stats();
+    ASSERT_EQ(stats.misses, 4);
+    ASSERT_EQ(stats.evictions, 2);
+}
+
+TEST(ParseCache, ConcurrentAccess)
+{
+    tcalc::parse_cache cache{8};
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < 4; t++)
+    {
+        threads.emplace_back([&cache]
+        {
+            for (int i = 0; i < 1000; i++)
+            {
+                const auto result = cache.parse(std::to_string(i % 16) + "*2", true, precision);
+                ASSERT_EQ(result->expressions.size(), 1);
+            }
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+
+    const auto stats = cache.stats();
+    ASSERT_EQ(stats.hits + stats.misses, 4000);
+    ASSERT_EQ(stats.size, 8);
+}
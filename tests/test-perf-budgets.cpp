@@ -0,0 +1,153 @@
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <format>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <gmp.h>
+
+#include "tc_evaluator.h"
+#include "tc_lexer.h"
+#include "tc_parser.h"
+
+namespace
+{
+    // Work counts per evaluation, which unlike times do not vary between runs or machines with the same libraries.
+    struct budget
+    {
+        long precision;
+        uint64_t allocations;
+        uint64_t bytes;
+        uint64_t operations;
+        std::string expression;
+    };
+
+    constexpr std::string_view budget_header =
+        "# Work budgets per evaluation, checked by tcalc_perf_tests. Each expression is evaluated once to warm MPFR's\n"
+        "# caches at its precision, then measured on its second evaluation, in degree and complex mode. Allocations\n"
+        "# and bytes count every GMP, MPFR and MPC allocation, so they also catch MPFR recomputing a constant such as\n"
+        "# pi that it should have cached; operations are counted by TCALC_STATS.\n"
+        "# After an intended change, regenerate with TCALC_UPDATE_BUDGETS=1 and review the diff.\n"
+        "#\n"
+        "# precision allocations bytes   operations expression\n";
+
+    uint64_t allocations = 0;
+    uint64_t allocated_bytes = 0;
+
+    void* counting_alloc(const size_t size)
+    {
+        allocations++;
+        allocated_bytes += size;
+        void* ptr = std::malloc(size);
+        if (ptr == nullptr)
+            std::abort();
+        return ptr;
+    }
+
+    void* counting_realloc(void* ptr, const size_t old_size, const size_t new_size)
+    {
+        allocations++;
+        if (new_size > old_size)
+            allocated_bytes += new_size - old_size;
+        ptr = std::realloc(ptr, new_size);
+        if (ptr == nullptr)
+            std::abort();
+        return ptr;
+    }
+
+    void counting_free(void* ptr, size_t)
+    {
+        std::free(ptr);
+    }
+
+    // Installed before the first number is created, as blocks must be freed by the allocator that made them
+    class counting_environment final : public testing::Environment
+    {
+    public:
+        void SetUp() override
+        {
+            mp_set_memory_functions(&counting_alloc, &counting_realloc, &counting_free);
+        }
+    };
+
+    [[maybe_unused]]
+    testing::Environment* const environment = testing::AddGlobalTestEnvironment(new counting_environment);
+
+    std::vector<budget> load_budgets(const std::string& path)
+    {
+        std::vector<budget> budgets;
+        std::ifstream file{path};
+        for (std::string line; std::getline(file, line);)
+        {
+            if (line.empty() || line.front() == '#')
+                continue;
+
+            budget b;
+            std::istringstream fields{line};
+            fields >> b.precision >> b.allocations >> b.bytes >> b.operations;
+            std::getline(fields >> std::ws, b.expression);
+            if (!fields.fail() && !b.expression.empty())
+                budgets.push_back(std::move(b));
+        }
+        return budgets;
+    }
+
+    std::string format_budget(const budget& b)
+    {
+        return std::format("{:<9} {:<11} {:<7} {:<10} {}", b.precision, b.allocations, b.bytes, b.operations,
+                           b.expression);
+    }
+
+    budget measure(const long precision, const std::string& input)
+    {
+        tcalc::evaluator evaluator{precision};
+        tcalc::parser parser{tcalc::lexer{input, true}, precision};
+        const auto expr = parser.parse_expression();
+        EXPECT_TRUE(parser.diagnostic_bag().empty()) << input;
+
+        // The first evaluation fills MPFR's caches at this precision, which later ones only read
+        (void)evaluator.evaluate(expr);
+        (void)evaluator.take_stats();
+
+        const uint64_t allocations_before = allocations;
+        const uint64_t bytes_before = allocated_bytes;
+        const auto result = evaluator.evaluate(expr);
+        const uint64_t measured_allocations = allocations - allocations_before;
+        const uint64_t measured_bytes = allocated_bytes - bytes_before;
+        const auto stats = evaluator.take_stats();
+
+        return {precision, measured_allocations, measured_bytes, stats.number_operations, input};
+    }
+}
+
+TEST(PerfBudgets, WithinBudget)
+{
+    const auto budgets = load_budgets(TCALC_PERF_BUDGETS);
+    ASSERT_FALSE(budgets.empty()) << "no budgets in " << TCALC_PERF_BUDGETS;
+
+    std::vector<budget> measured;
+    std::string diff;
+    for (const auto& b : budgets)
+    {
+        measured.push_back(measure(b.precision, b.expression));
+        const auto& m = measured.back();
+        if (m.allocations > b.allocations || m.bytes > b.bytes || m.operations > b.operations)
+            diff += std::format("- {}\n+ {}\n", format_budget(b), format_budget(m));
+    }
+
+    if (std::getenv("TCALC_UPDATE_BUDGETS") != nullptr)
+    {
+        std::ofstream file{TCALC_PERF_BUDGETS, std::ios::binary};
+        file << budget_header;
+        for (const auto& m : measured)
+            file << format_budget(m) << '\n';
+        ASSERT_TRUE(file.flush()) << "cannot write " << TCALC_PERF_BUDGETS;
+        return;
+    }
+
+    ASSERT_TRUE(diff.empty()) << "over budget (-budget, +measured); if intended, regenerate with "
+                                 "TCALC_UPDATE_BUDGETS=1:\n" << diff;
+}
@@ -0,0 +1,76 @@
+#include <gtest/gtest.h>
+
+#include <format>
+
+#include "tc_evaluator.h"
+#include "tc_pipeline.h"
+
+constexpr long precision = 64;
+
+static std::vector<std::string> run_pipeline(const std::vector<std::string>& inputs,
+                                             const tcalc::pipeline_options& options,
+                                             tcalc::pipeline_stats* stats = nullptr)
+{
+    const tcalc::evaluator prototype{precision};
+    tcalc::pipeline pipeline{prototype, options};
+
+    size_t next = 0;
+    std::vector<std::string> outputs;
+    const auto result = pipeline.run(
+        [&](std::string& input)
+        {
+            if (next == inputs.size())
+                return false;
+            input = inputs[next++];
+            return true;
+        },
+        [&](const std::string_view output) { outputs.emplace_back(output); });
+
+    if (stats != nullptr)
+        *stats = result;
+    return outputs;
+}
+
+TEST(Pipeline, FormatsResultsAndErrors)
+{
+    const std::vector<std::string> inputs = {"1+2", "", "x=3", "2>1", "1/0", "1+", "sqrt(16):2*3"};
+    const auto outputs = run_pipeline(inputs, {});
+
+    const std::vector<std::string> expected = {
+        "3", "", "3", "true", "error divide_by_zero", "error unexpected_token", "4; 6"
+    };
+    ASSERT_EQ(outputs, expected);
+}
+
+TEST(Pipeline, KeepsInputOrderAcrossWorkers)
+{
+    std::vector<std::string> inputs;
+    std::vector<std::string> expected;
+    for (int i = 0; i < 20000; i++)
+    {
+        // Uneven work so that workers finish out of order
+        inputs.push_back(i % 7 == 0 ? std::format("{}+sin(1)-sin(1)+cos(0)^50", i) : std::format("{}+1", i));
+        expected.push_back(std::to_string(i + 1));
+    }
+
+    tcalc::pipeline_stats stats{};
+    const auto outputs = run_pipeline(inputs, {.parse_workers = 3, .eval_workers = 4, .queue_capacity = 16}, &stats);
+    ASSERT_EQ(outputs, expected);
+
+    for (const auto stage : {tcalc::pipeline_stage::read, tcalc::pipeline_stage::parse, tcalc::pipeline_stage::evaluate,
+                             tcalc::pipeline_stage::format, tcalc::pipeline_stage::write})
+        ASSERT_EQ(stats[stage].items, inputs.size()) << tcalc::pipeline_stage_name(stage);
+
+    ASSERT_LE(stats[tcalc::pipeline_stage::parse].max_queue_depth, 16);
+}
+
+TEST(Pipeline, WriteErrorsPropagate)
+{
+    const tcalc::evaluator prototype{precision};
+    tcalc::pipeline pipeline{prototype, {.eval_workers = 2, .queue_capacity = 2}};
+
+    int remaining = 100;
+    ASSERT_THROW(pipeline.run([&](std::string& input) { input = "1"; return remaining-- > 0; },
+                              [](std::string_view) { throw std::runtime_error{"disk full"}; }),
+                 std::runtime_error);
+}
@@ -35,5 +35,29 @@ INSTANTIATE_TEST_SUITE_P(
         std::pair{"sqrt(-1)", tcalc::eval_error_type::real_mode_complex_result},
         std::pair{"root(-1, 4)", tcalc::eval_error_type::real_mode_complex_result},
         std::pair{"ln(-1) - ln(-1)", tcalc::eval_error_type::real_mode_complex_result},
-        std::pair{"3+2i", tcalc::eval_error_type::real_mode_complex_result}
+        std::pair{"3+2i", tcalc::eval_error_type::real_mode_complex_result},
+        std::pair{"cbrt(-8)", tcalc::eval_error_type::real_mode_complex_result},
+        std::pair{"log(-10)", tcalc::eval_error_type::real_mode_complex_result},
+        std::pair{"log(8, -2)", tcalc::eval_error_type::real_mode_complex_result},
+        std::pair{"(-8)^(1/3)", tcalc::eval_error_type::real_mode_complex_result},
+        std::pair{"asin(2)", tcalc::eval_error_type::real_mode_complex_result},
+        std::pair{"acos(-1.5)", tcalc::eval_error_type::real_mode_complex_result},
+        std::pair{"asec(0.5)", tcalc::eval_error_type::real_mode_complex_result},
+        std::pair{"acsc(-0.5)", tcalc::eval_error_type::real_mode_complex_result},
+        std::pair{"acosh(0.5)", tcalc::eval_error_type::real_mode_complex_result},
+        std::pair{"atanh(2)", tcalc::eval_error_type::real_mode_complex_result},
+        std::pair{"asech(2)", tcalc::eval_error_type::real_mode_complex_result},
+        std::pair{"acoth(0.5)", tcalc::eval_error_type::real_mode_complex_result},
+        std::pair{"√(-4)", tcalc::eval_error_type::real_mode_complex_result},
+        std::pair{"2√(-4)", tcalc::eval_error_type::real_mode_complex_result},
+        std::pair{"∛(-8)", tcalc::eval_error_type::real_mode_complex_result},
+        std::pair{"∜(-16)", tcalc::eval_error_type::real_mode_complex_result}
+    ));
+
+INSTANTIATE_TEST_SUITE_P(
+    RealModeDomainErrorsTakePrecedence, RealModeErrors,
+    testing::Values(
+        std::pair{"ln(0)", tcalc::eval_error_type::log_zero},
+        std::pair{"acoth(1)", tcalc::eval_error_type::out_of_acoth_domain},
+        std::pair{"asec(0)", tcalc::eval_error_type::out_of_asec_domain}
     ));
\ No newline at end of file
@@ -0,0 +1,110 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+
+#include "tc_evaluator.h"
+#include "tc_lexer.h"
+#include "tc_parser.h"
+
+constexpr long precision = 64;
+
+static std::string repeat(const std::string_view str, const size_t times)
+{
+    std::string result;
+    result.reserve(str.size() * times);
+    for (size_t i = 0; i < times; i++)
+        result += str;
+    return result;
+}
+
+static tcalc::arithmetic_expression parse_arithmetic(const std::string& input)
+{
+    tcalc::parser parser{tcalc::lexer::borrowing(input, true), precision};
+    auto expr = parser.parse_expression();
+    EXPECT_TRUE(parser.diagnostic_bag().empty());
+    return std::get<tcalc::arithmetic_expression>(std::move(expr));
+}
+
+static std::string evaluate(const tcalc::arithmetic_expression& expr)
+{
+    const tcalc::evaluator evaluator{precision};
+    auto result = evaluator.evaluate_arithmetic(expr);
+    if (result.is_error())
+        return std::string{tcalc::eval_error_type_name(result.error().type)};
+    return result.value().string();
+}
+
+TEST(Scaling, DeepParentheses)
+{
+    constexpr size_t depth = 100'000;
+    const auto expr = parse_arithmetic(repeat("(", depth) + "1" + repeat(")", depth));
+    ASSERT_EQ(expr.max_stack_depth, 1);
+    ASSERT_EQ(evaluate(expr), "1");
+}
+
+TEST(Scaling, DeepFunctionCalls)
+{
+    constexpr size_t depth = 100'000;
+    const auto expr = parse_arithmetic(repeat("abs(", depth) + "-1" + repeat(")", depth));
+    ASSERT_EQ(evaluate(expr), "1");
+}
+
+TEST(Scaling, DeepRightAssociativeChain)
+{
+    constexpr size_t depth = 100'000;
+    const auto expr = parse_arithmetic(repeat("1^", depth) + "1");
+    ASSERT_EQ(expr.max_stack_depth, depth + 1);
+    ASSERT_EQ(evaluate(expr), "1");
+}
+
+TEST(Scaling, NestingLimitIsDiagnosed)
+{
+    const std::string input = repeat("(", tcalc::parser::max_nesting_depth + 1) + "1:2";
+    tcalc::parser parser{tcalc::lexer::borrowing(input, true), precision};
+    const auto exprs = parser.parse_all();
+
+    ASSERT_EQ(parser.diagnostic_bag().size(), 1);
+    ASSERT_EQ(parser.diagnostic_bag()[0].type(), tcalc::diagnostic_type::nesting_too_deep);
+    ASSERT_EQ(exprs.size(), 2); // Parsing resumes after the expression separator
+}
+
+TEST(Scaling, LongSumIsLinear)
+{
+    struct sum_cost
+    {
+        size_t operations;
+        size_t operation_capacity;
+        size_t stack_depth;
+        uint64_t number_constructions;
+        uint64_t number_operations;
+    };
+
+    const auto sum = [](const size_t terms)
+    {
+        const auto expr = parse_arithmetic("1" + repeat("+1", terms - 1));
+        const tcalc::evaluator evaluator{precision};
+        const auto result = evaluator.evaluate_arithmetic(expr);
+        EXPECT_EQ(result.is_error() ? std::string{"error"} : result.value().string(), std::to_string(terms));
+
+        const auto stats = evaluator.stats();
+        return sum_cost{expr.tokens.size(), expr.tokens.capacity(), expr.max_stack_depth, stats.number_constructions,
+                        stats.number_operations};
+    };
+
+    const auto small = sum(250'000);
+    const auto large = sum(1'000'000);
+
+    // One operation per term and per operator, stored in memory linear in their count, and a constant stack
+    ASSERT_EQ(large.operations, 2 * 1'000'000 - 1);
+    ASSERT_LE(large.operation_capacity, 2 * large.operations);
+    ASSERT_EQ(small.stack_depth, 2);
+    ASSERT_EQ(large.stack_depth, 2);
+
+    if (!tcalc::evaluator::stats_enabled)
+        return; // The counters are checked by tcalc_stats_tests
+
+    // One addition per operator, while the numbers created do not depend on the length: the stack reuses its slots
+    ASSERT_EQ(small.number_operations, 250'000 - 1);
+    ASSERT_EQ(large.number_operations, 1'000'000 - 1);
+    ASSERT_EQ(small.number_constructions, large.number_constructions);
+}
@@ -0,0 +1,52 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <string>
+
+#ifdef _WIN32
+#include <process.h>
+#define popen _popen
+#define pclose _pclose
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+// Runs tcalc serve on stdin with the given request lines and returns everything it writes.
+static std::string serve(const std::string& requests)
+{
+    const auto path = std::filesystem::temp_directory_path() / std::format("tcalc-serve-test-{}.jsonl", getpid());
+    {
+        std::ofstream out{path, std::ios::binary};
+        out << requests;
+    }
+
+    const std::string command = std::format("\"{}\" serve < \"{}\"", TCALC_EXECUTABLE, path.string());
+    std::string output;
+    if (FILE* pipe = popen(command.c_str(), "r"))
+    {
+        char buffer[4096];
+        for (size_t read; (read = std::fread(buffer, 1, sizeof buffer, pipe)) > 0;)
+            output.append(buffer, read);
+        pclose(pipe);
+    }
+    std::filesystem::remove(path);
+    return output;
+}
+
+TEST(Serve, RejectsDigitsBeyondTheMaximumPrecision)
+{
+    const std::string output = serve(
+        "{\"id\":1,\"expression\":\"1/4\",\"digits\":2,\"format\":\"fixed\"}\n"
+        "{\"id\":2,\"expression\":\"1/3\",\"digits\":2000000000,\"format\":\"fixed\"}\n"
+        "{\"id\":3,\"expression\":\"1/3\",\"digits\":19729}\n"
+        "{\"id\":4,\"expression\":\"1/3\",\"digits\":19730}\n");
+
+    ASSERT_NE(output.find(R"({"id":1,"results":["0.25"]})"), std::string::npos) << output;
+    ASSERT_NE(output.find(R"({"id":2,"error":{"kind":"request","type":"bad_digits"}})"), std::string::npos) << output;
+    ASSERT_NE(output.find(R"({"id":3,"results":[)"), std::string::npos) << output;
+    ASSERT_NE(output.find(R"({"id":4,"error":{"kind":"request","type":"bad_digits"}})"), std::string::npos) << output;
+}
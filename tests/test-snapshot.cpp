@@ -0,0 +1,175 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <sstream>
+
+#include "tc_evaluator.h"
+#include "tc_lexer.h"
+#include "tc_parser.h"
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+constexpr long precision = 64;
+
+// Unique to this process, so that concurrent runs of the tests do not share files.
+static std::filesystem::path temp_path(const std::string_view name)
+{
+#ifdef _WIN32
+    const int pid = _getpid();
+#else
+    const int pid = getpid();
+#endif
+    return std::filesystem::temp_directory_path() / std::format("tcalc-test-{}-{}.bin", name, pid);
+}
+
+static tcalc::evaluator::result_type run(tcalc::evaluator& evaluator, const std::string_view input)
+{
+    tcalc::parser parser{tcalc::lexer{std::string{input}, true}, evaluator.precision()};
+    auto expr = parser.parse_expression();
+    if (!parser.diagnostic_bag().empty())
+        throw std::invalid_argument{std::string{input}};
+
+    auto result = evaluator.evaluate(expr);
+    if (result.is_error())
+        throw std::invalid_argument{std::format("{}: {}", input, tcalc::eval_error_type_name(result.error().type))};
+    evaluator.commit_result(result.value());
+    return result.value();
+}
+
+static std::string run_string(tcalc::evaluator& evaluator, const std::string_view input)
+{
+    return std::get<tcalc::number>(run(evaluator, input)).string();
+}
+
+TEST(Snapshot, RoundTripsVariablesAndSettings)
+{
+    tcalc::evaluator original{precision};
+    original.trig_unit(tcalc::angle_unit::radians);
+    original.complex_mode(false);
+    run(original, "x=1/3");
+    run(original, "y=-2.5e-300");
+    run(original, "z=0");
+    original.complex_mode(true);
+    run(original, "w=(1+2i)^0.5");
+    original.complex_mode(false);
+    run(original, "x*3");
+
+    std::stringstream stream;
+    original.save(stream);
+
+    tcalc::evaluator restored{precision * 2};
+    ASSERT_TRUE(restored.load(stream));
+    ASSERT_EQ(restored.precision(), precision);
+    ASSERT_EQ(restored.trig_unit(), tcalc::angle_unit::radians);
+    ASSERT_FALSE(restored.complex_mode());
+
+    for (const auto* name : {"Ans", "x", "y", "z", "w"})
+        ASSERT_EQ(run_string(restored, name), run_string(original, name)) << name;
+    ASSERT_TRUE(std::get<bool>(run(restored, "x==1/3"))); // Bit-exact, not just equal when printed
+}
+
+TEST(Snapshot, AssignmentsShadowSnapshotAndAreSavedAgain)
+{
+    tcalc::evaluator original{precision};
+    run(original, "a=1");
+    run(original, "b=2");
+
+    std::stringstream first;
+    original.save(first);
+
+    tcalc::evaluator restored{precision};
+    ASSERT_TRUE(restored.load(first));
+    run(restored, "b=20");
+    run(restored, "c=a+b");
+    ASSERT_EQ(run_string(restored, "b"), "20");
+
+    std::stringstream second;
+    restored.save(second);
+    tcalc::evaluator again{precision};
+    ASSERT_TRUE(again.load(second));
+    ASSERT_EQ(run_string(again, "a"), "1");
+    ASSERT_EQ(run_string(again, "b"), "20");
+    ASSERT_EQ(run_string(again, "c"), "21");
+}
+
+TEST(Snapshot, LoadReplacesVariables)
+{
+    tcalc::evaluator empty{precision};
+    std::stringstream stream;
+    empty.save(stream);
+
+    tcalc::evaluator evaluator{precision};
+    run(evaluator, "q=5");
+    ASSERT_TRUE(evaluator.load(stream));
+    ASSERT_THROW(run(evaluator, "q"), std::invalid_argument);
+    ASSERT_EQ(run_string(evaluator, "pi*0"), "0");
+}
+
+TEST(Snapshot, RejectsDamagedData)
+{
+    tcalc::evaluator original{precision};
+    run(original, "x=7");
+    std::stringstream stream;
+    original.save(stream);
+    const std::string bytes = stream.str();
+
+    tcalc::evaluator evaluator{precision};
+    run(evaluator, "x=1");
+
+    for (const size_t length : {size_t{0}, size_t{10}, bytes.size() - 1})
+    {
+        std::istringstream truncated{bytes.substr(0, length)};
+        ASSERT_FALSE(evaluator.load(truncated)) << length;
+    }
+
+    std::string bad_magic = bytes;
+    bad_magic[0] = 'x';
+    std::istringstream bad{bad_magic};
+    ASSERT_FALSE(evaluator.load(bad));
+
+    std::istringstream trailing{bytes + "junk"};
+    ASSERT_FALSE(evaluator.load(trailing));
+
+    std::string huge_precision = bytes;
+    const int64_t precision_field = int64_t{1} << 40;
+    std::memcpy(huge_precision.data() + 16, &precision_field, sizeof precision_field); // After magic, BOM, limb size
+    std::istringstream huge{huge_precision};
+    ASSERT_FALSE(evaluator.load(huge));
+
+    ASSERT_EQ(run_string(evaluator, "x"), "1");
+}
+
+TEST(Snapshot, MapsFileAndRestoresManyVariables)
+{
+    constexpr int count = 100000;
+    tcalc::evaluator original{precision};
+    for (int i = 0; i < count; i++)
+        run(original, std::format("v{}={}/7", i, i));
+
+    const auto path = temp_path("snapshot");
+    {
+        std::ofstream out{path, std::ios::binary};
+        original.save(out);
+    }
+
+    tcalc::evaluator restored{precision};
+    ASSERT_TRUE(restored.load_file(path.string()));
+
+    for (const int i : {0, 1, 4242, count - 1})
+    {
+        const auto name = std::format("v{}", i);
+        ASSERT_EQ(run_string(restored, name), run_string(original, name));
+        ASSERT_EQ(run_string(restored, name), run_string(original, name)); // Decoded once, then cached
+    }
+
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <thread>
+
+#include "tc_evaluator.h"
+#include "tc_lexer.h"
+#include "tc_parser.h"
+#include "tc_trace.h"
+
+constexpr long precision = 64;
+
+static void run(const tcalc::evaluator& evaluator, const std::string_view input)
+{
+    tcalc::parser parser{tcalc::lexer{std::string{input}, true}, precision};
+    const auto expr = parser.parse_expression();
+    ASSERT_TRUE(parser.diagnostic_bag().empty());
+    const auto result = evaluator.evaluate(expr);
+    ASSERT_FALSE(result.is_error());
+    if (const auto* num = std::get_if<tcalc::number>(&result.value()))
+        (void)num->string();
+}
+
+static size_t count(const std::string& str, const std::string_view part)
+{
+    size_t found = 0;
+    for (size_t at = str.find(part); at != std::string::npos; at = str.find(part, at + 1))
+        found++;
+    return found;
+}
+
+TEST(Trace, RecordsSpans)
+{
+    const tcalc::evaluator evaluator{precision};
+    tcalc::start_tracing();
+    run(evaluator, "sin(30)+sqrt(2)*3");
+    tcalc::stop_tracing();
+    run(evaluator, "cos(60)");
+
+    std::ostringstream out;
+    tcalc::write_trace(out);
+    const std::string trace = out.str();
+
+    ASSERT_TRUE(trace.starts_with(R"({"displayTimeUnit":"ns","traceEvents":[)"));
+    ASSERT_TRUE(trace.ends_with("]}\n"));
+    ASSERT_EQ(count(trace, R"("name":"lexer::next")"), 1);
+    ASSERT_EQ(count(trace, R"("args":{"tokens":)"), 1);
+    ASSERT_EQ(count(trace, R"("name":"parser::parse_expression")"), 1);
+    ASSERT_EQ(count(trace, R"("name":"evaluator::evaluate_arithmetic")"), 1);
+    ASSERT_EQ(count(trace, R"("name":"sin")"), 1);
+    ASSERT_EQ(count(trace, R"("name":"sqrt")"), 1);
+    ASSERT_EQ(count(trace, R"("name":"cos")"), 0);
+    ASSERT_EQ(count(trace, R"("name":"number::string")"), 1);
+    ASSERT_EQ(count(trace, R"("args":{"precision":64})"), 3);
+}
+
+TEST(Trace, RingKeepsNewestSpans)
+{
+    const tcalc::evaluator evaluator{precision};
+    tcalc::start_tracing(4);
+    for (int i = 0; i < 10; i++)
+        run(evaluator, "1+1");
+    tcalc::stop_tracing();
+
+    std::ostringstream out;
+    tcalc::write_trace(out);
+    const std::string trace = out.str();
+
+    ASSERT_EQ(count(trace, R"("ph":"X")"), 4);
+    ASSERT_EQ(count(trace, R"("ph":"M")"), 1);
+    ASSERT_EQ(count(trace, R"("name":"number::string")"), 1);
+}
+
+TEST(Trace, ExitedThreadsHandOverTheirBuffers)
+{
+    const tcalc::evaluator evaluator{precision};
+    tcalc::start_tracing();
+    for (int i = 0; i < 20; i++)
+        std::thread{[&evaluator] { run(evaluator, "1+1"); }}.join();
+    tcalc::stop_tracing();
+
+    std::ostringstream out;
+    tcalc::write_trace(out);
+    const std::string trace = out.str();
+
+    ASSERT_EQ(count(trace, R"("name":"evaluator::evaluate_arithmetic")"), 20);
+    ASSERT_EQ(count(trace, R"("ph":"M")"), 1); // One buffer, passed from each thread to the next
+}